@@ -0,0 +1,193 @@
+//
+// Created by mxu49 on 2026/10/18.
+// g++ -std=c++17 -o analysisDaemon analysisDaemon.cpp graph.cpp graphFile.cpp node.cpp namePool.cpp staticAnalyzer.cpp srcMLParser.cpp elementStream.cpp codePreprocessor.cpp taintSet.cpp functionCache.cpp mappedFile.cpp projectIndex.cpp functionIndex.cpp sourceStore.cpp elfFile.cpp `xml2-config --cflags --libs` -lsrcml -ldwarf
+//
+// Loads a graph file, the definitions and the pollution info once and answers queries
+// over a Unix domain socket, so the graph, its path caches and the parsed functions stay warm between queries.
+// The sinks (the crash frame of the saved backtrace and the sink file) are known before the graph is contracted,
+// so a sink matching a contraction rule such as __asan_memcpy stays queryable.
+// One request per line, one JSON object per line as the answer:
+//   chains <sink> [thread]              call chains from main to the sink
+//   taint <function> <#i> [<#j> ...]    taint of a function given tainted parameters
+//   reload-pollution <pollution_info>   replace the pollution info
+//   quit                                stop the daemon
+//
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "graph.h"
+
+static int printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <socket_path> <graph.bin> <binary> <define.json> <pollution_info> [contraction_rules] [function_cache_dir] [project_index] [taint_state] [sink_file]" << std::endl;
+    return 1;
+}
+
+static nlohmann::json chainsQuery(Graph& graph, const std::vector<std::string>& parts) {
+    if (parts.size() < 2) {
+        return {{"error", "usage: chains <sink> [thread]"}};
+    }
+    Node* sink = graph.findNode(parts[1].c_str());
+    if (sink == NULL) {
+        return {{"error", "sink " + parts[1] + " not found"}};
+    }
+    int thread = parts.size() > 2 ? std::atoi(parts[2].c_str()) : -1;
+    nlohmann::json chains = nlohmann::json::array();
+    for (const auto& chain : graph.findAllCallChains({sink}, thread)) {
+        nlohmann::json path = nlohmann::json::array();
+        for (Node* node : chain.path) {
+            path.push_back(std::string(node->get_name()));
+        }
+        chains.push_back(path);
+    }
+    return {{"sink", parts[1]}, {"thread", thread}, {"chains", chains}};
+}
+
+static nlohmann::json taintQuery(Graph& graph, StaticAnalyzer& analyzer, const char* binary_name,
+                                 const std::vector<std::string>& parts) {
+    if (parts.size() < 3) {
+        return {{"error", "usage: taint <function> <#i> [<#j> ...]"}};
+    }
+    std::set<std::string> params;
+    for (size_t i = 2; i < parts.size(); i++) {
+        if (parts[i][0] != '#') {
+            return {{"error", "parameters are given as #<index>, got " + parts[i]}};
+        }
+        params.insert(parts[i]);
+    }
+    TaintMap taintMap = graph.taintFunction(binary_name, analyzer, parts[1], params);
+    nlohmann::json taint = nlohmann::json::object();
+    for (const auto& [function, taints] : taintMap) {
+        taint[function] = {{"variables", analyzer.variableNames(function, taints.variables)},
+                           {"params", paramSlotNames(taints.params)}};
+    }
+    return {{"function", parts[1]}, {"taint", taint}};
+}
+
+static nlohmann::json reloadQuery(Graph& graph, StaticAnalyzer& analyzer, const std::vector<std::string>& parts) {
+    if (parts.size() != 2) {
+        return {{"error", "usage: reload-pollution <pollution_info>"}};
+    }
+    if (!graph.loadPollutionInfo(parts[1], true)) {
+        return {{"error", "unable to load pollution info " + parts[1]}};
+    }
+    return {{"reloaded", parts[1]}, {"functions", graph.pollutionTaintMap(analyzer).size()}};
+}
+
+// answers the requests of one client until it disconnects, returns false on quit
+static bool serveClient(int client, Graph& graph, StaticAnalyzer& analyzer, const char* binary_name) {
+    std::string pending;
+    char buffer[4096];
+    while (true) {
+        size_t newline = pending.find('\n');
+        if (newline == std::string::npos) {
+            ssize_t received = read(client, buffer, sizeof(buffer));
+            if (received <= 0) {
+                return true;
+            }
+            pending.append(buffer, received);
+            continue;
+        }
+        std::string line = pending.substr(0, newline);
+        pending.erase(0, newline + 1);
+        std::vector<std::string> parts = graph.splitBySpace(line);
+        if (parts.empty()) {
+            continue;
+        }
+        std::cout << "Request: " << line << std::endl;
+        if (parts[0] == "quit") {
+            return false;
+        }
+
+        nlohmann::json answer;
+        if (parts[0] == "chains") {
+            answer = chainsQuery(graph, parts);
+        } else if (parts[0] == "taint") {
+            answer = taintQuery(graph, analyzer, binary_name, parts);
+        } else if (parts[0] == "reload-pollution") {
+            answer = reloadQuery(graph, analyzer, parts);
+        } else {
+            answer = {{"error", "unknown request " + parts[0]}};
+        }
+        std::string reply = answer.dump() + "\n";
+        for (size_t sent = 0; sent < reply.size(); ) {
+            ssize_t written = write(client, reply.data() + sent, reply.size() - sent);
+            if (written <= 0) {
+                return true;
+            }
+            sent += written;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 6) {
+        return printUsage(argv[0]);
+    }
+    const char* socket_path = argv[1];
+    const char* binary_name = argv[3];
+
+    Graph graph;
+    if (!graph.loadBinary(argv[2])) {
+        return 1;
+    }
+    graph.loadDefineJson(argv[4]);
+    graph.loadPollutionInfo(argv[5]);
+    if (argc > 6) {
+        graph.loadContractionRules(argv[6]);
+    }
+    if (argc > 7) {
+        graph.setFunctionCacheDir(argv[7]);
+    }
+    if (argc > 8) {
+        graph.loadProjectIndex(argv[8]);
+    }
+    graph.addBacktraceSink();
+    if (argc > 10) {
+        graph.loadSinks(argv[10]);
+    }
+    graph.contractGraph();
+    StaticAnalyzer analyzer;
+    // taint results survive restarts of the daemon, they are saved when it is told to quit
+    const char* taint_state = argc > 9 ? argv[9] : NULL;
+    if (taint_state != NULL) {
+        analyzer.loadTaintState(taint_state);
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        std::cerr << "Error: socket path " << socket_path << " is too long" << std::endl;
+        return 1;
+    }
+    strcpy(address.sun_path, socket_path);
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (server == -1 || bind(server, (sockaddr*)&address, sizeof(address)) != 0 || listen(server, 4) != 0) {
+        std::cerr << "Error: unable to listen on " << socket_path << std::endl;
+        return 1;
+    }
+    // a client that goes away in the middle of an answer must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+    std::cout << "Listening on " << socket_path << std::endl;
+
+    bool running = true;
+    while (running) {
+        int client = accept(server, NULL, NULL);
+        if (client == -1) {
+            continue;
+        }
+        running = serveClient(client, graph, analyzer, binary_name);
+        close(client);
+    }
+    close(server);
+    unlink(socket_path);
+    if (taint_state != NULL) {
+        analyzer.saveTaintState(taint_state);
+    }
+    xmlCleanupParser();
+    return 0;
+}
@@ -2,6 +2,7 @@
 // Created by mxu49 on 2024/8/13.
 // g++ -o srcML_test srcML_test.cpp `xml2-config --cflags --libs`
 //
+#include <csignal>
 #include <cstring>
 #include <iostream>
 #include <stack>
@@ -10,6 +11,9 @@
 #include "drwrap.h"
 #include "drsyms.h"
 #include "graph.h"
+#include "graphStore.h"
+#include "elfFile.h"
+#include "functionIndex.h"
 
 #define MAX_CALL_DEPTH 256
 
@@ -17,7 +21,20 @@ std::set<std::string> function_names;
 static int num_functions = 0;
 
 static Graph* call_graph;
-static std::stack<const char*> call_stack;
+static std::string graph_file;
+static std::string graph_store_dir;
+// set when ASan starts a report or a fatal signal reaches the application
+static volatile bool run_crashed = false;
+
+// every application thread keeps its own call stack, otherwise calls of one thread
+// would be attributed to callers that are on the stack of another
+struct thread_data_t {
+    std::stack<const char*> call_stack;
+    uint32_t thread_index;      // creation order, matches the T<n> numbering of ASan
+};
+static int tls_index = -1;
+static volatile int thread_count = 0;
+static void* graph_lock;
 
 struct symbol_filter_data_t {
     const char *func_name; // Function name to wrap
@@ -27,14 +44,42 @@ struct symbol_filter_data_t {
 
 static void event_exit(void);
 
+static void event_thread_init(void *drcontext) {
+    thread_data_t* data = new thread_data_t();
+    data->thread_index = dr_atomic_add32_return_sum(&thread_count, 1) - 1;
+    drmgr_set_tls_field(drcontext, tls_index, data);
+}
+
+static void event_thread_exit(void *drcontext) {
+    thread_data_t* data = (thread_data_t*)drmgr_get_tls_field(drcontext, tls_index);
+    delete data;
+    drmgr_set_tls_field(drcontext, tls_index, NULL);
+}
+
+static void asan_error_pre(void *, void **) {
+    run_crashed = true;
+}
+
+static dr_signal_action_t event_signal(void *, dr_siginfo_t *info) {
+    if (info->sig == SIGSEGV || info->sig == SIGBUS || info->sig == SIGABRT || info->sig == SIGFPE || info->sig == SIGILL) {
+        run_crashed = true;
+    }
+    return DR_SIGNAL_DELIVER;
+}
+
 static void generic_wrap_pre(void *wrapcxt, void **user_data) {
     const char *func_name = (const char *)*user_data;
     //dr_printf("Function %s is called\n", func_name);  // Added logging
-    call_stack.push(func_name);
+    thread_data_t* data = (thread_data_t*)drmgr_get_tls_field(drwrap_get_drcontext(wrapcxt), tls_index);
+    data->call_stack.push(func_name);
 }
 
 static void generic_wrap_post(void *wrapcxt, void *user_data) {
     const char *func_name = (const char *)user_data;
+    // wrapcxt is NULL when the function is unwound by longjmp or an exception
+    void* drcontext = wrapcxt == NULL ? dr_get_current_drcontext() : drwrap_get_drcontext(wrapcxt);
+    thread_data_t* data = (thread_data_t*)drmgr_get_tls_field(drcontext, tls_index);
+    std::stack<const char*>& call_stack = data->call_stack;
     if (call_stack.empty()) {
         return;
     }
@@ -45,10 +90,11 @@ static void generic_wrap_post(void *wrapcxt, void *user_data) {
         return;
     }
     const char* caller = call_stack.top();
-    std::stack<const char*> temp = call_stack;
-
-    call_graph->addCall(caller, current);
 
+    // the graph is shared by all threads
+    dr_mutex_lock(graph_lock);
+    call_graph->addCallOnThread(caller, current, data->thread_index);
+    dr_mutex_unlock(graph_lock);
 }
 
 void load_function_names(const char *filename) {
@@ -98,6 +144,11 @@ void load_function_names(const char *filename) {
 /* Callback function to filter and wrap symbols */
 static bool symbol_filter(drsym_info_t *info, drsym_error_t status, void *data) {
 
+    // ASan calls this hook first thing in every error report
+    if (strcmp(info->name, "__asan_on_error") == 0) {
+        drwrap_wrap((app_pc)data + info->start_offs, asan_error_pre, NULL);
+        return true;
+    }
     if (function_names.find(info->name) == function_names.end()) {
         return true;
     }
@@ -131,7 +182,7 @@ static void module_load_event(void *drcontext, const module_data_t *mod, bool lo
 
 DR_EXPORT void dr_client_main(client_id_t id, int argc, const char *argv[]) {
     if (argc < 5) {
-        dr_printf("Usage: %s <function_names_file> <backtrace_file> <define.json> <pollution_info>\n", argv[0]);
+        dr_printf("Usage: %s <function_names_file> <backtrace_file> <define.json> <pollution_info> [sink_file] [graph_file] [graph_store_dir] [contraction_rules] [function_cache_dir] [project_index] [taint_state]\n", argv[0]);
         return;
     }
     //print all of the arguments
@@ -149,8 +200,15 @@ DR_EXPORT void dr_client_main(client_id_t id, int argc, const char *argv[]) {
         dr_exit_process(1);
     }
     dr_register_exit_event(event_exit);
+    dr_register_signal_event(event_signal);
+    tls_index = drmgr_register_tls_field();
+    graph_lock = dr_mutex_create();
+    drmgr_register_thread_init_event(event_thread_init);
+    drmgr_register_thread_exit_event(event_thread_exit);
     drmgr_register_module_load_event(module_load_event);
     call_graph = new Graph();
+    // the index is built inside event_exit, and DynamoRIO does not support raw threads in a client
+    FunctionIndex::disableReaderThreads();
 
     call_graph->parseASanOutput(argv[2]);
     std::cout << "Backtrace loaded" << std::endl;
@@ -161,6 +219,30 @@ DR_EXPORT void dr_client_main(client_id_t id, int argc, const char *argv[]) {
     call_graph->loadPollutionInfo(argv[4]);
     std::cout << "Pollution information loaded" << std::endl;
 
+    if (argc > 5) {
+        call_graph->loadSinks(argv[5]);
+        std::cout << "Sinks loaded" << std::endl;
+    }
+    if (argc > 6) {
+        graph_file = argv[6];
+    }
+    if (argc > 7) {
+        graph_store_dir = argv[7];
+    }
+    if (argc > 8) {
+        call_graph->loadContractionRules(argv[8]);
+        std::cout << "Contraction rules loaded" << std::endl;
+    }
+    if (argc > 9) {
+        call_graph->setFunctionCacheDir(argv[9]);
+    }
+    if (argc > 10) {
+        call_graph->loadProjectIndex(argv[10]);
+    }
+    if (argc > 11) {
+        call_graph->setTaintStateFile(argv[11]);
+    }
+
     call_graph->addBacktrace();
 
 }
@@ -169,6 +251,9 @@ static void event_exit(void) {
     dr_printf("Client 'my_client' exiting\n");
     call_graph->removeInterceptors();
     call_graph->printGraph();
+    if (!graph_file.empty()) {
+        call_graph->saveBinary(graph_file);
+    }
     const module_data_t *main_module = dr_get_main_module();
     if (main_module == NULL) {
         dr_printf("Failed to get main module\n");
@@ -176,12 +261,25 @@ static void event_exit(void) {
     }else{
         const char* binary_path = main_module->full_path;
 
+        // the backtrace given on the command line may come from an earlier run, only a crash
+        // seen in this one marks the run as crashing
+        if (!graph_store_dir.empty()) {
+            GraphStore store(graph_store_dir, readBuildId(binary_path));
+            if (store.open()) {
+                store.merge(*call_graph, run_crashed, "pid " + std::to_string(dr_get_process_id()));
+            }
+        }
+
         call_graph->Traversal(binary_path);
     }
 
 
 
     delete call_graph;
+    // libxml2 is shared with libsrcml, so it is only torn down once at exit
+    xmlCleanupParser();
+    dr_mutex_destroy(graph_lock);
+    drmgr_unregister_tls_field(tls_index);
     drwrap_exit();
     drmgr_exit();
     drmgr_exit();
@@ -0,0 +1,285 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "codePreprocessor.h"
+#include <vector>
+
+static bool isIdentifierStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool isIdentifierChar(char c) {
+    return isIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static size_t skipSpaces(std::string_view code, size_t i) {
+    while (i < code.size() && (isBlank(code[i]) || code[i] == '\n')) {
+        i++;
+    }
+    return i;
+}
+
+static bool isCastKeyword(std::string_view word) {
+    return word == "static_cast" || word == "reinterpret_cast" || word == "dynamic_cast" || word == "const_cast";
+}
+
+static bool isStringPrefix(std::string_view word) {
+    return word == "L" || word == "u" || word == "U" || word == "u8";
+}
+
+static bool isRawStringPrefix(std::string_view word) {
+    return word == "R" || word == "LR" || word == "uR" || word == "UR" || word == "u8R";
+}
+
+// position after the '>' matching the '<' at i, or npos
+static size_t skipTemplateArguments(std::string_view code, size_t i) {
+    int depth = 0;
+    for (; i < code.size(); i++) {
+        if (code[i] == '<') {
+            depth++;
+        } else if (code[i] == '>') {
+            if (--depth == 0) {
+                return i + 1;
+            }
+        } else if (code[i] == ';' || code[i] == '{' || code[i] == '}') {
+            return std::string_view::npos;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// position after a C-style cast "(type) name" starting at the '(' at i, or npos when it is not one
+static size_t skipCStyleCast(std::string_view code, size_t i) {
+    size_t j = skipSpaces(code, i + 1);
+    if (j >= code.size() || !(isIdentifierStart(code[j]) || code[j] == ':')) {
+        return std::string_view::npos;
+    }
+    for (; j < code.size() && code[j] != ')'; j++) {
+        char c = code[j];
+        if (!(isIdentifierChar(c) || c == ':' || c == '<' || c == '>' || c == '*' || c == '&' || isBlank(c))) {
+            return std::string_view::npos;
+        }
+    }
+    if (j >= code.size()) {
+        return std::string_view::npos;
+    }
+    j = skipSpaces(code, j + 1);
+    if (j >= code.size() || !isIdentifierStart(code[j])) {
+        return std::string_view::npos;
+    }
+    return j;
+}
+
+// position after the string literal whose opening quote is at i
+static size_t skipString(std::string_view code, size_t i) {
+    for (i++; i < code.size() && code[i] != '"' && code[i] != '\n'; i++) {
+        if (code[i] == '\\' && i + 1 < code.size()) {
+            i++;
+        }
+    }
+    return i < code.size() && code[i] == '"' ? i + 1 : i;
+}
+
+// position after the raw string literal R"delimiter(...)delimiter" whose opening quote is at i
+static size_t skipRawString(std::string_view code, size_t i) {
+    size_t open = code.find('(', i + 1);
+    if (open == std::string_view::npos) {
+        return skipString(code, i);
+    }
+    std::string closing = ")" + std::string(code.substr(i + 1, open - i - 1)) + "\"";
+    size_t close = code.find(closing, open + 1);
+    return close == std::string_view::npos ? code.size() : close + closing.size();
+}
+
+class SourceScanner {
+private:
+    std::string_view code;
+    std::string output;
+    // output position where the current line starts
+    size_t lineStart;
+    int parenDepth;
+    // depths whose closing parenthesis belongs to a removed cast or sizeof
+    std::vector<int> droppedParens;
+
+    void endLine() {
+        while (this->output.size() > this->lineStart && isBlank(this->output.back())) {
+            this->output.pop_back();
+        }
+        if (this->output.size() > this->lineStart) {
+            this->output.push_back(' ');
+        }
+        this->lineStart = this->output.size();
+    }
+
+    void put(char c) {
+        // leading spaces of a line are dropped
+        if (isBlank(c) && this->output.size() == this->lineStart) {
+            return;
+        }
+        this->output.push_back(c);
+    }
+
+    void putSpace() {
+        if (this->output.size() > this->lineStart && !isBlank(this->output.back())) {
+            this->output.push_back(' ');
+        }
+    }
+
+    // opens a parenthesis whose closing one is dropped together with it
+    size_t dropParen(size_t i) {
+        this->parenDepth++;
+        this->droppedParens.push_back(this->parenDepth);
+        return i + 1;
+    }
+
+    // the identifier right before the current output position, if any
+    std::string_view previousWord() {
+        size_t end = this->output.size();
+        while (end > this->lineStart && isBlank(this->output[end - 1])) {
+            end--;
+        }
+        size_t begin = end;
+        while (begin > 0 && isIdentifierChar(this->output[begin - 1])) {
+            begin--;
+        }
+        return std::string_view(this->output).substr(begin, end - begin);
+    }
+
+    char previousChar() {
+        for (size_t i = this->output.size(); i > 0; i--) {
+            if (!isBlank(this->output[i - 1])) {
+                return this->output[i - 1];
+            }
+        }
+        return '\0';
+    }
+
+    // a parenthesis right after a name, ')' or ']' is a call or an index, not a cast
+    bool mayStartCast() {
+        char previous = previousChar();
+        if (isIdentifierChar(previous)) {
+            return previousWord() == "return";
+        }
+        return previous != ')' && previous != ']';
+    }
+
+    size_t scanWord(size_t i) {
+        size_t end = i;
+        while (end < this->code.size() && isIdentifierChar(this->code[end])) {
+            end++;
+        }
+        std::string_view word = this->code.substr(i, end - i);
+        if (isIdentifierStart(word[0])) {
+            if (end < this->code.size() && this->code[end] == '"') {
+                if (isRawStringPrefix(word)) {
+                    return skipRawString(this->code, end);
+                }
+                if (isStringPrefix(word)) {
+                    return skipString(this->code, end);
+                }
+            }
+            if (word == "sizeof") {
+                size_t next = skipSpaces(this->code, end);
+                if (next < this->code.size() && this->code[next] == '(') {
+                    return skipSpaces(this->code, dropParen(next));
+                }
+                return next;
+            }
+            if (isCastKeyword(word)) {
+                size_t next = skipSpaces(this->code, end);
+                if (next < this->code.size() && this->code[next] == '<') {
+                    size_t arguments = skipTemplateArguments(this->code, next);
+                    if (arguments != std::string_view::npos) {
+                        arguments = skipSpaces(this->code, arguments);
+                        if (arguments < this->code.size() && this->code[arguments] == '(') {
+                            return skipSpaces(this->code, dropParen(arguments));
+                        }
+                    }
+                }
+            }
+        }
+        this->output.append(word);
+        return end;
+    }
+
+public:
+    explicit SourceScanner(std::string_view code) {
+        this->code = code;
+        this->output.reserve(code.size() + 1);
+        this->lineStart = 0;
+        this->parenDepth = 0;
+    }
+
+    std::string scan() {
+        size_t i = 0;
+        while (i < this->code.size()) {
+            char c = this->code[i];
+            char next = i + 1 < this->code.size() ? this->code[i + 1] : '\0';
+            if (c == '\n') {
+                endLine();
+                i++;
+            } else if (c == '/' && next == '/') {
+                while (i < this->code.size() && this->code[i] != '\n') {
+                    i++;
+                }
+            } else if (c == '/' && next == '*') {
+                putSpace();
+                for (i += 2; i < this->code.size() && !(this->code[i] == '*' && i + 1 < this->code.size() && this->code[i + 1] == '/'); i++) {
+                    if (this->code[i] == '\n') {
+                        endLine();
+                    }
+                }
+                i = i < this->code.size() ? i + 2 : i;
+            } else if (c == '"') {
+                i = skipString(this->code, i);
+            } else if (c == '\'') {
+                // character literals are kept, only skipped over so that '"' does not open a string
+                size_t end = i + 1;
+                for (; end < this->code.size() && this->code[end] != '\'' && this->code[end] != '\n'; end++) {
+                    if (this->code[end] == '\\' && end + 1 < this->code.size()) {
+                        end++;
+                    }
+                }
+                end = end < this->code.size() && this->code[end] == '\'' ? end + 1 : end;
+                this->output.append(this->code.substr(i, end - i));
+                i = end;
+            } else if (isIdentifierChar(c)) {
+                i = scanWord(i);
+            } else if (c == '(') {
+                size_t cast = mayStartCast() ? skipCStyleCast(this->code, i) : std::string_view::npos;
+                if (cast != std::string_view::npos) {
+                    i = cast;
+                } else {
+                    this->parenDepth++;
+                    put(c);
+                    i++;
+                }
+            } else if (c == ')') {
+                if (!this->droppedParens.empty() && this->droppedParens.back() == this->parenDepth) {
+                    this->droppedParens.pop_back();
+                    while (this->output.size() > this->lineStart && isBlank(this->output.back())) {
+                        this->output.pop_back();
+                    }
+                } else {
+                    put(c);
+                }
+                this->parenDepth--;
+                i++;
+            } else {
+                put(c);
+                i++;
+            }
+        }
+        endLine();
+        return std::move(this->output);
+    }
+};
+
+std::string preprocessSource(std::string_view code) {
+    return SourceScanner(code).scan();
+}
@@ -0,0 +1,20 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_CODEPREPROCESSOR_H
+#define DYNAMORIO_CODEPREPROCESSOR_H
+
+#include <string>
+#include <string_view>
+
+// Prepares the source of a function for srcML in one pass over the characters:
+//   - comments are dropped, block comments may span lines
+//   - string literals are dropped, character literals are kept
+//   - xxx_cast<T>(expr) and C-style casts (T) name keep only the expression
+//   - sizeof(expr) and sizeof name keep only the operand
+//   - every non-empty line is trimmed and followed by a single space, so the result is one line
+std::string preprocessSource(std::string_view code);
+
+
+#endif //DYNAMORIO_CODEPREPROCESSOR_H
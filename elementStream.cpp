@@ -0,0 +1,265 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "elementStream.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+#define SRCML_SRC_NAMESPACE "http://www.srcML.org/srcML/src"
+
+ElementStream::ElementStream() {
+    this->callOrder = 0;
+}
+
+xmlSAXHandler ElementStream::saxHandler() {
+    // nothing but the three callbacks, so libxml2 builds no tree of its own
+    xmlSAXHandler handler;
+    memset(&handler, 0, sizeof(handler));
+    handler.initialized = XML_SAX2_MAGIC;
+    handler.startElementNs = startElement;
+    handler.endElementNs = endElement;
+    handler.characters = characters;
+    handler.cdataBlock = characters;
+    handler.ignorableWhitespace = characters;
+    return handler;
+}
+
+std::vector<CodeElement> ElementStream::takeElements() {
+    return std::move(this->elements);
+}
+
+static bool isStatement(const std::string& name) {
+    return name == "decl" || name == "parameter" || name == "return" || name == "call" || name == "expr";
+}
+
+void ElementStream::start(const xmlChar* localname, const xmlChar* URI) {
+    Frame* parent = this->stack.empty() ? NULL : &this->stack.back();
+    Frame f;
+    f.name = (const char*)localname;
+    f.src = URI != NULL && !xmlStrcmp(URI, (const xmlChar*)SRCML_SRC_NAMESPACE);
+    f.ignored = (parent != NULL && parent->ignored) ||
+                f.name == "comment" || f.name == "function_decl" || f.name == "type";
+    f.statement = !f.ignored && isStatement(f.name);
+    bool isType = f.src && f.name == "type";
+    f.removedType = isType && parent != NULL && parent->statement;
+    f.inType = (parent != NULL && parent->inType) || isType;
+    f.collecting = (parent != NULL && parent->collecting && !f.removedType) || f.statement ||
+                   (f.src && f.name == "name");
+    f.hasIndex = false;
+    f.functionFrame = parent == NULL ? -1 : (parent->name == "function" ? (int)this->stack.size() - 1 : parent->functionFrame);
+    f.functionName = f.functionFrame == -1 ? "" : this->stack[f.functionFrame].functionName;
+    f.firstElement = this->elements.size();
+    f.hasName = false;
+    f.order = 0;
+    f.argumentLists = 0;
+    f.hasArguments = false;
+    f.sawArguments = false;
+    f.position = 0;
+    f.argumentOf = -1;
+    f.argumentPosition = 0;
+    if (f.src && f.name == "call") {
+        // calls are listed in document order, the order of their start tags
+        f.order = this->callOrder++;
+    }
+
+    if (parent != NULL && parent->src && parent->name == "name" && f.src && f.name == "index") {
+        parent->hasIndex = true;
+    }
+    if (parent != NULL && parent->name == "call" && f.name == "argument_list") {
+        parent->argumentLists++;
+    }
+    // an argument of the first argument list of a call takes the names of its position
+    if (parent != NULL && f.name == "argument" && parent->name == "argument_list" && this->stack.size() >= 2) {
+        int callIndex = this->stack.size() - 2;
+        Frame& call = this->stack[callIndex];
+        if (call.name == "call" && call.argumentLists == 1) {
+            call.hasArguments = true;
+            call.sawArguments = true;
+            if (call.arguments.size() <= call.position) {
+                call.arguments.resize(call.position + 1);
+            }
+            f.argumentOf = callIndex;
+            f.argumentPosition = call.position;
+        }
+    }
+    this->stack.push_back(std::move(f));
+}
+
+void ElementStream::text(const xmlChar* characters, int length) {
+    if (this->stack.empty()) {
+        return;
+    }
+    Frame& top = this->stack.back();
+    if (top.collecting) {
+        top.content.append((const char*)characters, length);
+    }
+    // commas between the arguments of a call count the positions, so an argument emptied
+    // by the preprocessor (a string constant) still keeps the place of the ones after it
+    if (top.name == "argument_list" && this->stack.size() >= 2) {
+        Frame& call = this->stack[this->stack.size() - 2];
+        if (call.name == "call" && call.argumentLists == 1) {
+            for (int i = 0; i < length; i++) {
+                if (characters[i] == ',') {
+                    call.position++;
+                    call.sawArguments = true;
+                }
+            }
+        }
+    }
+}
+
+void ElementStream::endName(Frame& name) {
+    size_t index = this->stack.size() - 1;
+    if (index == 0) {
+        return;
+    }
+    Frame& parent = this->stack[index - 1];
+    // the first name of a function is its context, also for what was emitted in it before the name
+    if (parent.name == "function" && !parent.hasName) {
+        parent.hasName = true;
+        parent.functionName = name.content;
+        for (size_t i = parent.firstElement; i < this->elements.size(); i++) {
+            this->elements[i].functionName = name.content;
+        }
+    }
+    if (parent.name == "call") {
+        if (!parent.hasName) {
+            parent.hasName = true;
+            parent.callee = name.content;
+        }
+        std::string funcName = name.content;
+        funcName.erase(std::remove_if(funcName.begin(), funcName.end(), ::isspace), funcName.end());
+        parent.calleeNames.push_back(funcName);
+    }
+
+    // a variable is a name outside types, not the name of a call or a macro and without an index;
+    // member names after -> stay, like the former XPath that compared against "-&gt;"
+    if (!name.src || name.inType || name.hasIndex || (parent.src && (parent.name == "call" || parent.name == "macro"))) {
+        return;
+    }
+    static const std::vector<std::string> keywords = {
+            "int", "char", "void", "NULL", "errno", "sizeof", "defined"
+    };
+    const std::string& varName = name.content;
+    if (std::find(keywords.begin(), keywords.end(), varName) != keywords.end() ||
+        varName.find("TINYDIR_STRING") != std::string::npos ||
+        varName.find("_FUNC") != std::string::npos) {
+        return;
+    }
+    // every statement and call argument above the name uses it
+    for (size_t i = index; i-- > 0; ) {
+        Frame& frame = this->stack[i];
+        if (frame.statement && (frame.name == "decl" || frame.name == "expr")) {
+            frame.variables.push_back(varName);
+        }
+        if (frame.argumentOf >= 0) {
+            this->stack[frame.argumentOf].arguments[frame.argumentPosition].push_back(varName);
+        }
+    }
+}
+
+void ElementStream::endCall(Frame& call) {
+    if (call.sawArguments) {
+        call.arguments.resize(call.position + 1);
+    }
+    // the call counts for itself and the statements above it, up to the type of a statement,
+    // which is not part of the statements around it
+    for (size_t i = this->stack.size(); i-- > 0; ) {
+        Frame& frame = this->stack[i];
+        if (frame.removedType) {
+            break;
+        }
+        if (!frame.statement || frame.name == "parameter" || frame.name == "return") {
+            continue;
+        }
+        for (const auto& funcName : call.calleeNames) {
+            if (!funcName.empty()) {
+                frame.calls.emplace_back(call.order, funcName, call.hasArguments);
+            }
+        }
+    }
+}
+
+static bool isValidExpression(const std::string& name, const std::string& content) {
+    return name == "decl" || name == "parameter" || name == "return" || name == "call" ||
+           (name == "expr" && content.find_first_of("=<>+-*/") != std::string::npos);
+}
+
+void ElementStream::emit(Frame& statement) {
+    if (!isValidExpression(statement.name, statement.content)) {
+        return;
+    }
+    CodeElement element{};
+    element.type = statement.name;
+    element.content = statement.content;
+    element.functionName = statement.functionName;
+    if (statement.name == "decl" || statement.name == "expr" || statement.name == "call") {
+        std::stable_sort(statement.calls.begin(), statement.calls.end(), [](const auto& a, const auto& b) {
+            return std::get<0>(a) < std::get<0>(b);
+        });
+        for (const auto& call : statement.calls) {
+            element.calls.push_back({std::get<1>(call), std::get<2>(call)});
+        }
+    }
+    if (statement.name == "decl" || statement.name == "expr") {
+        element.variables = std::move(statement.variables);
+        std::sort(element.variables.begin(), element.variables.end());
+        element.variables.erase(std::unique(element.variables.begin(), element.variables.end()), element.variables.end());
+    } else if (statement.name == "call") {
+        element.callee = statement.callee;
+        for (auto& argument : statement.arguments) {
+            std::sort(argument.begin(), argument.end());
+            argument.erase(std::unique(argument.begin(), argument.end()), argument.end());
+            element.variables.insert(element.variables.end(), argument.begin(), argument.end());
+        }
+        element.arguments = std::move(statement.arguments);
+        std::sort(element.variables.begin(), element.variables.end());
+        element.variables.erase(std::unique(element.variables.begin(), element.variables.end()), element.variables.end());
+    } else if (statement.name == "parameter") {
+        std::istringstream stream(element.content);
+        std::string var;
+        while (stream >> var) {
+            element.variables.push_back(var);
+        }
+    }
+    this->elements.push_back(std::move(element));
+}
+
+void ElementStream::end() {
+    if (this->stack.empty()) {
+        return;
+    }
+    Frame& f = this->stack.back();
+    if (f.src && f.name == "name") {
+        endName(f);
+    }
+    if (f.src && f.name == "call") {
+        endCall(f);
+    }
+    if (f.statement) {
+        emit(f);
+    }
+    if (this->stack.size() > 1) {
+        Frame& parent = this->stack[this->stack.size() - 2];
+        if (parent.collecting && !f.removedType) {
+            parent.content += f.content;
+        }
+    }
+    this->stack.pop_back();
+}
+
+void ElementStream::startElement(void* ctx, const xmlChar* localname, const xmlChar*, const xmlChar* URI,
+                                 int, const xmlChar**, int, int, const xmlChar**) {
+    ((ElementStream*)ctx)->start(localname, URI);
+}
+
+void ElementStream::endElement(void* ctx, const xmlChar*, const xmlChar*, const xmlChar*) {
+    ((ElementStream*)ctx)->end();
+}
+
+void ElementStream::characters(void* ctx, const xmlChar* ch, int len) {
+    ((ElementStream*)ctx)->text(ch, len);
+}
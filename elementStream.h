@@ -0,0 +1,77 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_ELEMENTSTREAM_H
+#define DYNAMORIO_ELEMENTSTREAM_H
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <libxml/parser.h>
+#include "staticAnalyzer.h"
+
+// Builds the CodeElements of srcML output from SAX events as the document streams in.
+// Every decl, parameter, return and call becomes an element, and so does an expr with an
+// operator in it, unless it lies inside a comment, a function_decl or a type. The type
+// directly under a statement is left out of its text.
+// Only the open elements are kept, each with the text and names gathered below it so far,
+// so the stream's own memory follows the nesting depth and the longest statement. The srcML
+// text of the unit is still built whole by libsrcml before it is written (see parseStream).
+class ElementStream {
+private:
+    struct Frame {
+        std::string name;
+        bool src;                   // in the srcML src namespace
+        bool ignored;               // inside comment, function_decl or type, nothing below becomes an element
+        bool statement;             // decl, parameter, return, call or expr that becomes an element
+        bool removedType;           // type directly under a statement, left out of its text and calls
+        bool inType;                // inside any type, the names are never variables
+        bool collecting;            // the text is kept, for a statement or a name
+        bool hasIndex;              // name frames: has an <index> child
+        std::string content;
+        int functionFrame;          // nearest enclosing function frame, -1 at the top
+        // function frames
+        std::string functionName;   // context of the elements below, the outer one until the name is seen
+        size_t firstElement;
+        bool hasName;
+        // statement frames
+        std::vector<std::string> variables;
+        std::vector<std::tuple<uint64_t, std::string, bool>> calls;    // {call order, callee, hasArguments}
+        // call frames
+        uint64_t order;
+        std::string callee;                         // first name, the function the call site calls
+        std::vector<std::string> calleeNames;       // every name without whitespace, as the calls list takes them
+        int argumentLists;
+        bool hasArguments;                          // the first argument list holds an argument
+        bool sawArguments;                          // an argument or a comma was seen, the positions count
+        size_t position;
+        std::vector<std::vector<std::string>> arguments;
+        // argument frames of the first argument list of a call
+        int argumentOf;
+        size_t argumentPosition;
+    };
+    std::vector<Frame> stack;
+    std::vector<CodeElement> elements;
+    uint64_t callOrder;
+    void start(const xmlChar* localname, const xmlChar* URI);
+    void end();
+    void text(const xmlChar* characters, int length);
+    void endName(Frame& name);
+    void endCall(Frame& call);
+    void emit(Frame& statement);
+    static void startElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI,
+                             int nb_namespaces, const xmlChar** namespaces, int nb_attributes, int nb_defaulted,
+                             const xmlChar** attributes);
+    static void endElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI);
+    static void characters(void* ctx, const xmlChar* ch, int len);
+public:
+    ElementStream();
+    // handlers that feed the stream passed as their user data
+    static xmlSAXHandler saxHandler();
+    std::vector<CodeElement> takeElements();
+};
+
+
+#endif //DYNAMORIO_ELEMENTSTREAM_H
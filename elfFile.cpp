@@ -0,0 +1,155 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "elfFile.h"
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string toHex(const unsigned char* bytes, size_t size) {
+    std::stringstream ss;
+    for (size_t i = 0; i < size; i++) {
+        ss << std::hex << std::setw(2) << std::setfill('0') << (int)bytes[i];
+    }
+    return ss.str();
+}
+
+// looks for NT_GNU_BUILD_ID in the SHT_NOTE sections of a 64-bit ELF image
+static std::string findBuildIdNote(const char* image, size_t size) {
+    if (size < sizeof(Elf64_Ehdr) || memcmp(image, ELFMAG, SELFMAG) != 0 || image[EI_CLASS] != ELFCLASS64) {
+        return "";
+    }
+    const Elf64_Ehdr* ehdr = (const Elf64_Ehdr*)image;
+    if (ehdr->e_shoff == 0 || ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr) > size) {
+        return "";
+    }
+    const Elf64_Shdr* sections = (const Elf64_Shdr*)(image + ehdr->e_shoff);
+    for (int i = 0; i < ehdr->e_shnum; i++) {
+        if (sections[i].sh_type != SHT_NOTE || sections[i].sh_offset + sections[i].sh_size > size) {
+            continue;
+        }
+        const char* note = image + sections[i].sh_offset;
+        const char* end = note + sections[i].sh_size;
+        while (note + sizeof(Elf64_Nhdr) <= end) {
+            const Elf64_Nhdr* nhdr = (const Elf64_Nhdr*)note;
+            const char* name = note + sizeof(Elf64_Nhdr);
+            const char* desc = name + ((nhdr->n_namesz + 3) & ~3u);
+            if (desc + nhdr->n_descsz > end) {
+                break;
+            }
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+                return toHex((const unsigned char*)desc, nhdr->n_descsz);
+            }
+            note = desc + ((nhdr->n_descsz + 3) & ~3u);
+        }
+    }
+    return "";
+}
+
+// maps the whole file read-only, NULL when it cannot be opened or is empty
+static const char* mapImage(const std::string& binary, size_t& size) {
+    int fd = open(binary.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error: unable to open file " << binary << std::endl;
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Error: unable to map file " << binary << std::endl;
+        return NULL;
+    }
+    size = st.st_size;
+    return (const char*)mapped;
+}
+
+std::string readBuildId(const std::string& binary) {
+    size_t size = 0;
+    const char* image = mapImage(binary, size);
+    if (image == NULL) {
+        return "";
+    }
+    std::string buildId = findBuildIdNote(image, size);
+    if (buildId.empty()) {
+        // binaries linked without --build-id are keyed by their contents instead
+        uint64_t hash = fnv1a(image, size);
+        buildId = "nobuildid-" + toHex((const unsigned char*)&hash, sizeof(hash));
+    }
+    munmap((void*)image, size);
+    return buildId;
+}
+
+// collects the defined STT_FUNC symbols of every section of the given type
+static int findFunctionSymbols(const char* image, size_t size, uint32_t type, std::vector<ElfSymbol>& symbols) {
+    const Elf64_Ehdr* ehdr = (const Elf64_Ehdr*)image;
+    const Elf64_Shdr* sections = (const Elf64_Shdr*)(image + ehdr->e_shoff);
+    int found = 0;
+    for (int i = 0; i < ehdr->e_shnum; i++) {
+        const Elf64_Shdr& section = sections[i];
+        if (section.sh_type != type || section.sh_link >= ehdr->e_shnum ||
+            section.sh_offset + section.sh_size > size || section.sh_entsize != sizeof(Elf64_Sym)) {
+            continue;
+        }
+        const Elf64_Shdr& strtab = sections[section.sh_link];
+        if (strtab.sh_offset + strtab.sh_size > size || strtab.sh_size == 0) {
+            continue;
+        }
+        const char* names = image + strtab.sh_offset;
+        const Elf64_Sym* syms = (const Elf64_Sym*)(image + section.sh_offset);
+        for (uint64_t s = 0; s < section.sh_size / sizeof(Elf64_Sym); s++) {
+            const Elf64_Sym& sym = syms[s];
+            if (ELF64_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_shndx == SHN_UNDEF ||
+                sym.st_value == 0 || sym.st_name >= strtab.sh_size) {
+                continue;
+            }
+            // names are null-terminated inside the string table, the last byte of which is 0
+            symbols.push_back({std::string(names + sym.st_name, strnlen(names + sym.st_name, strtab.sh_size - sym.st_name)),
+                               sym.st_value, sym.st_size});
+            found++;
+        }
+    }
+    return found;
+}
+
+bool readFunctionSymbols(const std::string& binary, std::vector<ElfSymbol>& symbols) {
+    size_t size = 0;
+    const char* image = mapImage(binary, size);
+    if (image == NULL) {
+        return false;
+    }
+    const Elf64_Ehdr* ehdr = (const Elf64_Ehdr*)image;
+    bool valid = size >= sizeof(Elf64_Ehdr) && memcmp(image, ELFMAG, SELFMAG) == 0 && image[EI_CLASS] == ELFCLASS64 &&
+                 ehdr->e_shoff != 0 && ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr) <= size;
+    if (!valid) {
+        std::cerr << "Error: " << binary << " is not a 64-bit ELF file" << std::endl;
+        munmap((void*)image, size);
+        return false;
+    }
+    if (findFunctionSymbols(image, size, SHT_SYMTAB, symbols) == 0) {
+        findFunctionSymbols(image, size, SHT_DYNSYM, symbols);
+    }
+    munmap((void*)image, size);
+    return true;
+}
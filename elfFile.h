@@ -0,0 +1,30 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_ELFFILE_H
+#define DYNAMORIO_ELFFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Helpers that read ELF binaries directly instead of running binutils.
+
+// hex string of the GNU build-id note, or "nobuildid-<hash of the file>" when the binary has none
+std::string readBuildId(const std::string& binary);
+
+struct ElfSymbol {
+    std::string name;
+    uint64_t address;
+    uint64_t size;
+};
+
+// defined functions (STT_FUNC) of .symtab, or of .dynsym when the binary is stripped
+bool readFunctionSymbols(const std::string& binary, std::vector<ElfSymbol>& symbols);
+
+// 64-bit FNV-1a hash, used for content keys
+uint64_t fnv1a(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+
+
+#endif //DYNAMORIO_ELFFILE_H
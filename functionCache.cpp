@@ -0,0 +1,253 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "functionCache.h"
+#include "elfFile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+ElementSections::ElementSections() {
+    // offset 0 is the empty string, elements without a callee point there
+    addString("");
+}
+
+uint32_t ElementSections::addString(const std::string& value) {
+    auto it = this->stringOffsets.find(value);
+    if (it != this->stringOffsets.end()) {
+        return it->second;
+    }
+    uint32_t offset = this->strings.size();
+    this->strings.append(value);
+    this->strings.push_back('\0');
+    this->stringOffsets.emplace(value, offset);
+    return offset;
+}
+
+void ElementSections::addElement(const CodeElement& element) {
+    FunctionCacheElement cached;
+    cached.type = addString(element.type);
+    cached.content = addString(element.content);
+    cached.functionName = addString(element.functionName);
+    cached.callee = addString(element.callee);
+    cached.variablesBegin = this->variables.size();
+    for (const auto& var : element.variables) {
+        this->variables.push_back(addString(var));
+    }
+    cached.variablesEnd = this->variables.size();
+    cached.callsBegin = this->calls.size();
+    for (const auto& call : element.calls) {
+        this->calls.push_back({addString(call.first), call.second ? 1u : 0u});
+    }
+    cached.callsEnd = this->calls.size();
+    cached.argumentsBegin = this->arguments.size();
+    for (const auto& argument : element.arguments) {
+        FunctionCacheArgument cachedArgument;
+        cachedArgument.variablesBegin = this->variables.size();
+        for (const auto& var : argument) {
+            this->variables.push_back(addString(var));
+        }
+        cachedArgument.variablesEnd = this->variables.size();
+        this->arguments.push_back(cachedArgument);
+    }
+    cached.argumentsEnd = this->arguments.size();
+    this->elements.push_back(cached);
+}
+
+CodeElement MappedElementSections::element(uint32_t index) const {
+    auto string = [this](uint32_t offset) {
+        return std::string(offset < this->stringTableSize ? this->strings + offset : "");
+    };
+    const FunctionCacheElement& cached = this->elements[index];
+    CodeElement element{};
+    element.type = string(cached.type);
+    element.content = string(cached.content);
+    element.functionName = string(cached.functionName);
+    element.callee = string(cached.callee);
+    for (uint32_t v = cached.variablesBegin; v < cached.variablesEnd && v < this->variableCount; v++) {
+        element.variables.push_back(string(this->variables[v]));
+    }
+    for (uint32_t c = cached.callsBegin; c < cached.callsEnd && c < this->callCount; c++) {
+        element.calls.push_back({string(this->calls[c].name), this->calls[c].hasArguments != 0});
+    }
+    for (uint32_t a = cached.argumentsBegin; a < cached.argumentsEnd && a < this->argumentCount; a++) {
+        variableInfo argument;
+        for (uint32_t v = this->arguments[a].variablesBegin; v < this->arguments[a].variablesEnd && v < this->variableCount; v++) {
+            argument.push_back(string(this->variables[v]));
+        }
+        element.arguments.push_back(argument);
+    }
+    return element;
+}
+
+FunctionCache::FunctionCache(std::string directory) {
+    this->directory = directory;
+    this->hits = 0;
+    this->misses = 0;
+    // the client creates the cache in dr_client_main, so a failure only leaves the cache unused
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    this->usable = !error;
+    if (error) {
+        std::cerr << "Error: unable to create function cache directory " << directory << ": " << error.message() << std::endl;
+    }
+}
+
+bool FunctionCache::isUsable() {
+    return this->usable;
+}
+
+bool hashSourceFile(const std::string& file_name, uint64_t& hash) {
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: unable to open file " << file_name << std::endl;
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string bytes = content.str();
+    hash = fnv1a(bytes.data(), bytes.size());
+    return true;
+}
+
+bool FunctionCache::hashFile(const std::string& file_name, uint64_t& hash) {
+    auto cached = this->fileHashes.find(file_name);
+    if (cached != this->fileHashes.end()) {
+        hash = cached->second;
+        return true;
+    }
+    if (!hashSourceFile(file_name, hash)) {
+        return false;
+    }
+    this->fileHashes[file_name] = hash;
+    return true;
+}
+
+std::string FunctionCache::entryPath(uint64_t contentHash, int start_line_number, int end_line_number) {
+    int32_t key[3] = {start_line_number, end_line_number, FUNCTION_CACHE_ANALYZER_VERSION};
+    uint64_t entry = fnv1a(key, sizeof(key), contentHash);
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.pfc", (unsigned long long)entry);
+    return this->directory + "/" + name;
+}
+
+bool FunctionCache::load(const std::string& file_name, int start_line_number, int end_line_number, std::vector<CodeElement>& elements) {
+    uint64_t contentHash;
+    if (!hashFile(file_name, contentHash)) {
+        return false;
+    }
+    std::string path = entryPath(contentHash, start_line_number, end_line_number);
+    MappedFile file;
+    if (!file.open(path, sizeof(FunctionCacheHeader))) {
+        this->misses++;
+        return false;
+    }
+    const char* mapping = file.data();
+    const FunctionCacheHeader* h = (const FunctionCacheHeader*)mapping;
+
+    // the header repeats the key, so a hash collision or a stale entry is never used
+    bool valid = memcmp(h->magic, FUNCTION_CACHE_MAGIC, sizeof(FUNCTION_CACHE_MAGIC)) == 0 &&
+                 h->version == FUNCTION_CACHE_VERSION &&
+                 h->analyzerVersion == FUNCTION_CACHE_ANALYZER_VERSION &&
+                 h->contentHash == contentHash &&
+                 h->startLine == start_line_number && h->endLine == end_line_number &&
+                 file.sectionFits(h->elementsOffset, h->elementCount, sizeof(FunctionCacheElement)) &&
+                 file.sectionFits(h->variablesOffset, h->variableCount, 4) &&
+                 file.sectionFits(h->callsOffset, h->callCount, sizeof(FunctionCacheCall)) &&
+                 file.sectionFits(h->argumentsOffset, h->argumentCount, sizeof(FunctionCacheArgument)) &&
+                 file.stringTableFits(h->stringTableOffset, h->stringTableSize);
+    if (!valid) {
+        std::cerr << "Error: ignoring invalid function cache entry " << path << std::endl;
+        this->misses++;
+        return false;
+    }
+
+    MappedElementSections sections;
+    sections.elements = (const FunctionCacheElement*)(mapping + h->elementsOffset);
+    sections.variables = (const uint32_t*)(mapping + h->variablesOffset);
+    sections.variableCount = h->variableCount;
+    sections.calls = (const FunctionCacheCall*)(mapping + h->callsOffset);
+    sections.callCount = h->callCount;
+    sections.arguments = (const FunctionCacheArgument*)(mapping + h->argumentsOffset);
+    sections.argumentCount = h->argumentCount;
+    sections.strings = mapping + h->stringTableOffset;
+    sections.stringTableSize = h->stringTableSize;
+    elements.clear();
+    elements.reserve(h->elementCount);
+    for (uint32_t i = 0; i < h->elementCount; i++) {
+        elements.push_back(sections.element(i));
+    }
+    this->hits++;
+    return true;
+}
+
+bool FunctionCache::store(const std::string& file_name, int start_line_number, int end_line_number, const std::vector<CodeElement>& elements) {
+    uint64_t contentHash;
+    if (!hashFile(file_name, contentHash)) {
+        return false;
+    }
+
+    ElementSections sections;
+    for (const auto& element : elements) {
+        sections.addElement(element);
+    }
+
+    FunctionCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FUNCTION_CACHE_MAGIC, sizeof(FUNCTION_CACHE_MAGIC));
+    header.version = FUNCTION_CACHE_VERSION;
+    header.analyzerVersion = FUNCTION_CACHE_ANALYZER_VERSION;
+    header.contentHash = contentHash;
+    header.startLine = start_line_number;
+    header.endLine = end_line_number;
+    header.elementCount = sections.elements.size();
+    header.variableCount = sections.variables.size();
+    header.callCount = sections.calls.size();
+    header.argumentCount = sections.arguments.size();
+    header.stringTableSize = sections.strings.size();
+    uint64_t offset = alignSection(sizeof(header));
+    header.elementsOffset = offset;
+    offset = alignSection(offset + sections.elements.size() * sizeof(FunctionCacheElement));
+    header.variablesOffset = offset;
+    offset = alignSection(offset + sections.variables.size() * 4);
+    header.callsOffset = offset;
+    offset = alignSection(offset + sections.calls.size() * sizeof(FunctionCacheCall));
+    header.argumentsOffset = offset;
+    offset = alignSection(offset + sections.arguments.size() * sizeof(FunctionCacheArgument));
+    header.stringTableOffset = offset;
+
+    // written under a temporary name and renamed, a reader never sees half an entry
+    std::string path = entryPath(contentHash, start_line_number, end_line_number);
+    AtomicFileWriter file;
+    if (!file.open(path)) {
+        std::cerr << "Error: unable to open file " << file.temporaryPath() << std::endl;
+        return false;
+    }
+    file.put(0, &header, sizeof(header));
+    file.put(header.elementsOffset, sections.elements.data(), sections.elements.size() * sizeof(FunctionCacheElement));
+    file.put(header.variablesOffset, sections.variables.data(), sections.variables.size() * 4);
+    file.put(header.callsOffset, sections.calls.data(), sections.calls.size() * sizeof(FunctionCacheCall));
+    file.put(header.argumentsOffset, sections.arguments.data(), sections.arguments.size() * sizeof(FunctionCacheArgument));
+    file.put(header.stringTableOffset, sections.strings.data(), sections.strings.size());
+    if (!file.commit()) {
+        std::cerr << "Error: unable to write function cache entry " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FunctionCache::forgetFile(const std::string& file_name) {
+    this->fileHashes.erase(file_name);
+}
+
+int FunctionCache::getHits() {
+    return this->hits;
+}
+
+int FunctionCache::getMisses() {
+    return this->misses;
+}
@@ -0,0 +1,124 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_FUNCTIONCACHE_H
+#define DYNAMORIO_FUNCTIONCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "staticAnalyzer.h"
+#include "mappedFile.h"
+
+// Parsed functions kept on disk across runs, one file per entry in the cache directory.
+// An entry is addressed by the hash of the source file contents, the line range and the
+// analyzer version, so editing a file only invalidates the functions of that file:
+//   header | elements | variables | calls | arguments | string table
+// Like the graph file, every section starts 8-byte aligned and is used straight from mmap.
+#define FUNCTION_CACHE_MAGIC "PFFUNC"
+#define FUNCTION_CACHE_VERSION 2
+// bump whenever parsing or extraction changes what ends up in a CodeElement
+#define FUNCTION_CACHE_ANALYZER_VERSION 4
+
+struct FunctionCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t analyzerVersion;
+    uint64_t contentHash;
+    int32_t startLine;
+    int32_t endLine;
+    uint32_t elementCount;
+    uint32_t variableCount;
+    uint32_t callCount;
+    uint32_t argumentCount;
+    uint32_t stringTableSize;
+    uint32_t reserved;
+    uint64_t elementsOffset;       // FunctionCacheElement[elementCount]
+    uint64_t variablesOffset;      // uint32_t[variableCount], offsets into the string table
+    uint64_t callsOffset;          // FunctionCacheCall[callCount]
+    uint64_t argumentsOffset;      // FunctionCacheArgument[argumentCount]
+    uint64_t stringTableOffset;
+};
+
+struct FunctionCacheElement {
+    uint32_t type;
+    uint32_t content;
+    uint32_t functionName;
+    uint32_t callee;
+    uint32_t variablesBegin;       // variables of the element are [variablesBegin, variablesEnd)
+    uint32_t variablesEnd;
+    uint32_t callsBegin;           // calls of the element are [callsBegin, callsEnd)
+    uint32_t callsEnd;
+    uint32_t argumentsBegin;       // arguments of a call element are [argumentsBegin, argumentsEnd)
+    uint32_t argumentsEnd;
+};
+
+struct FunctionCacheCall {
+    uint32_t name;
+    uint32_t hasArguments;
+};
+
+// the names of one call argument are [variablesBegin, variablesEnd) of the variables section
+struct FunctionCacheArgument {
+    uint32_t variablesBegin;
+    uint32_t variablesEnd;
+};
+
+// element sections as they are built before writing, shared by cache entries and the project index
+class ElementSections {
+private:
+    std::unordered_map<std::string, uint32_t> stringOffsets;
+public:
+    std::string strings;
+    std::vector<FunctionCacheElement> elements;
+    std::vector<uint32_t> variables;
+    std::vector<FunctionCacheCall> calls;
+    std::vector<FunctionCacheArgument> arguments;
+    ElementSections();
+    uint32_t addString(const std::string& value);
+    void addElement(const CodeElement& element);
+};
+
+// element sections of a mapped file, ranges reaching past a section are cut off
+struct MappedElementSections {
+    const FunctionCacheElement* elements;
+    const uint32_t* variables;
+    uint32_t variableCount;
+    const FunctionCacheCall* calls;
+    uint32_t callCount;
+    const FunctionCacheArgument* arguments;
+    uint32_t argumentCount;
+    const char* strings;
+    uint32_t stringTableSize;
+    CodeElement element(uint32_t index) const;
+};
+
+// fnv1a of the whole file, the content hash of function cache entries and project index files
+bool hashSourceFile(const std::string& file_name, uint64_t& hash);
+
+class FunctionCache {
+private:
+    std::string directory;
+    // content hash of every source file seen in this run
+    std::unordered_map<std::string, uint64_t> fileHashes;
+    int hits;
+    int misses;
+    bool usable;
+    bool hashFile(const std::string& file_name, uint64_t& hash);
+    std::string entryPath(uint64_t contentHash, int start_line_number, int end_line_number);
+public:
+    explicit FunctionCache(std::string directory);
+    // false when the directory could not be created
+    bool isUsable();
+    bool load(const std::string& file_name, int start_line_number, int end_line_number, std::vector<CodeElement>& elements);
+    bool store(const std::string& file_name, int start_line_number, int end_line_number, const std::vector<CodeElement>& elements);
+    // hashes the file again on its next use, after it changed on disk
+    void forgetFile(const std::string& file_name);
+    int getHits();
+    int getMisses();
+};
+
+
+#endif //DYNAMORIO_FUNCTIONCACHE_H
@@ -0,0 +1,548 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "functionIndex.h"
+#include "elfFile.h"
+#include "mappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libdwarf.h>
+#include <dwarf.h>
+
+// address range of one function definition and where its code is in the source
+struct FunctionRange {
+    uint64_t lowPc;
+    uint64_t highPc;
+    FunctionLocation location;
+    std::vector<std::string> names;
+};
+
+struct LineRow {
+    uint64_t address;
+    int line;
+    int file;                      // index into the file names of the compilation unit
+};
+
+// one subprogram DIE with code, before its lines are known
+struct Subprogram {
+    uint64_t lowPc;
+    uint64_t highPc;
+    int declLine;
+    std::vector<std::string> names;
+    // [low, high) of the code inlined into it, its line rows belong to the inlined functions
+    std::vector<std::pair<uint64_t, uint64_t>> inlined;
+};
+
+static std::string attributeString(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name) {
+    Dwarf_Error err;
+    Dwarf_Attribute attr;
+    std::string value;
+    if (dwarf_attr(die, name, &attr, &err) != DW_DLV_OK) {
+        return value;
+    }
+    char* str = nullptr;
+    if (dwarf_formstring(attr, &str, &err) == DW_DLV_OK) {
+        value = str;
+        dwarf_dealloc(dbg, str, DW_DLA_STRING);
+    }
+    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
+    return value;
+}
+
+static bool attributeUnsigned(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name, Dwarf_Unsigned& value) {
+    Dwarf_Error err;
+    Dwarf_Attribute attr;
+    if (dwarf_attr(die, name, &attr, &err) != DW_DLV_OK) {
+        return false;
+    }
+    bool found = dwarf_formudata(attr, &value, &err) == DW_DLV_OK;
+    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
+    return found;
+}
+
+// DIE referenced by a DW_AT_specification or DW_AT_abstract_origin attribute
+static bool referencedDie(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half name, Dwarf_Die& target) {
+    Dwarf_Error err;
+    Dwarf_Attribute attr;
+    if (dwarf_attr(die, name, &attr, &err) != DW_DLV_OK) {
+        return false;
+    }
+    Dwarf_Off offset;
+    bool found = dwarf_global_formref(attr, &offset, &err) == DW_DLV_OK &&
+                 dwarf_offdie_b(dbg, offset, 1, &target, &err) == DW_DLV_OK;
+    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
+    return found;
+}
+
+// names and declaration line of a subprogram, out-of-line definitions and concrete
+// instances of inlined functions carry them on the DIE they refer to
+static void subprogramNames(Dwarf_Debug dbg, Dwarf_Die die, Subprogram& subprogram, int depth = 0) {
+    for (Dwarf_Half name : {(Dwarf_Half)DW_AT_name, (Dwarf_Half)DW_AT_linkage_name, (Dwarf_Half)DW_AT_MIPS_linkage_name}) {
+        std::string value = attributeString(dbg, die, name);
+        if (!value.empty() && std::find(subprogram.names.begin(), subprogram.names.end(), value) == subprogram.names.end()) {
+            subprogram.names.push_back(value);
+        }
+    }
+    Dwarf_Unsigned line;
+    if (subprogram.declLine == 0 && attributeUnsigned(dbg, die, DW_AT_decl_line, line)) {
+        subprogram.declLine = line;
+    }
+    if (depth > 4) {
+        return;
+    }
+    for (Dwarf_Half reference : {(Dwarf_Half)DW_AT_specification, (Dwarf_Half)DW_AT_abstract_origin}) {
+        Dwarf_Die target;
+        if (referencedDie(dbg, die, reference, target)) {
+            subprogramNames(dbg, target, subprogram, depth + 1);
+            dwarf_dealloc(dbg, target, DW_DLA_DIE);
+        }
+    }
+}
+
+static bool subprogramRange(Dwarf_Die die, uint64_t& lowPc, uint64_t& highPc) {
+    Dwarf_Error err;
+    Dwarf_Addr low, high;
+    Dwarf_Half form;
+    enum Dwarf_Form_Class formClass;
+    if (dwarf_lowpc(die, &low, &err) != DW_DLV_OK ||
+        dwarf_highpc_b(die, &high, &form, &formClass, &err) != DW_DLV_OK) {
+        return false;
+    }
+    // since DWARF 4 the high pc is usually an offset from the low pc
+    if (formClass == DW_FORM_CLASS_CONSTANT) {
+        high += low;
+    }
+    lowPc = low;
+    highPc = high;
+    return high > low;
+}
+
+// address ranges of a DIE, from its low and high pc or from its DW_AT_ranges list in .debug_ranges,
+// whose entries are relative to the base address of the compilation unit
+static void dieRanges(Dwarf_Debug dbg, Dwarf_Die die, uint64_t cuBase, std::vector<std::pair<uint64_t, uint64_t>>& ranges) {
+    uint64_t low, high;
+    if (subprogramRange(die, low, high)) {
+        ranges.push_back({low, high});
+        return;
+    }
+    Dwarf_Error err;
+    Dwarf_Attribute attr;
+    if (dwarf_attr(die, DW_AT_ranges, &attr, &err) != DW_DLV_OK) {
+        return;
+    }
+    Dwarf_Off offset;
+    bool found = dwarf_global_formref(attr, &offset, &err) == DW_DLV_OK;
+    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
+    Dwarf_Ranges* list;
+    Dwarf_Signed count;
+    Dwarf_Unsigned bytes;
+    // DWARF 5 range lists (DW_FORM_rnglistx) are not read, the rows of such a range are kept
+    if (!found || dwarf_get_ranges_a(dbg, offset, die, &list, &count, &bytes, &err) != DW_DLV_OK) {
+        return;
+    }
+    uint64_t base = cuBase;
+    for (Dwarf_Signed i = 0; i < count; i++) {
+        if (list[i].dwr_type == DW_RANGES_ADDRESS_SELECTION) {
+            base = list[i].dwr_addr2;
+        } else if (list[i].dwr_type == DW_RANGES_ENTRY && list[i].dwr_addr2 > list[i].dwr_addr1) {
+            ranges.push_back({base + list[i].dwr_addr1, base + list[i].dwr_addr2});
+        }
+    }
+    dwarf_ranges_dealloc(dbg, list, count);
+}
+
+// ranges of the code inlined into a subprogram, found in its lexical blocks as well, an inlined
+// subroutine's own inlines lie inside its ranges
+static void collectInlined(Dwarf_Debug dbg, Dwarf_Die parent, uint64_t cuBase, std::vector<std::pair<uint64_t, uint64_t>>& inlined) {
+    Dwarf_Error err;
+    Dwarf_Die child;
+    if (dwarf_child(parent, &child, &err) != DW_DLV_OK) {
+        return;
+    }
+    while (true) {
+        Dwarf_Half tag;
+        if (dwarf_tag(child, &tag, &err) == DW_DLV_OK) {
+            if (tag == DW_TAG_inlined_subroutine) {
+                dieRanges(dbg, child, cuBase, inlined);
+            } else if (tag == DW_TAG_lexical_block) {
+                collectInlined(dbg, child, cuBase, inlined);
+            }
+        }
+        Dwarf_Die sibling;
+        int res = dwarf_siblingof(dbg, child, &sibling, &err);
+        dwarf_dealloc(dbg, child, DW_DLA_DIE);
+        if (res != DW_DLV_OK) {
+            break;
+        }
+        child = sibling;
+    }
+}
+
+// collects the subprograms with code below a DIE, looking into namespaces and classes
+static void collectSubprograms(Dwarf_Debug dbg, Dwarf_Die parent, uint64_t cuBase, std::vector<Subprogram>& subprograms) {
+    Dwarf_Error err;
+    Dwarf_Die child;
+    if (dwarf_child(parent, &child, &err) != DW_DLV_OK) {
+        return;
+    }
+    while (true) {
+        Dwarf_Half tag;
+        if (dwarf_tag(child, &tag, &err) == DW_DLV_OK) {
+            Subprogram subprogram = {0, 0, 0, {}, {}};
+            if (tag == DW_TAG_subprogram && subprogramRange(child, subprogram.lowPc, subprogram.highPc)) {
+                subprogramNames(dbg, child, subprogram);
+                collectInlined(dbg, child, cuBase, subprogram.inlined);
+                subprograms.push_back(subprogram);
+            } else if (tag == DW_TAG_namespace || tag == DW_TAG_class_type || tag == DW_TAG_structure_type) {
+                collectSubprograms(dbg, child, cuBase, subprograms);
+            }
+        }
+        Dwarf_Die sibling;
+        int res = dwarf_siblingof(dbg, child, &sibling, &err);
+        dwarf_dealloc(dbg, child, DW_DLA_DIE);
+        if (res != DW_DLV_OK) {
+            break;
+        }
+        child = sibling;
+    }
+}
+
+static void collectLines(Dwarf_Debug dbg, Dwarf_Die cuDie, std::vector<LineRow>& rows, std::vector<std::string>& files) {
+    Dwarf_Error err;
+    Dwarf_Line* lines;
+    Dwarf_Signed count;
+    if (dwarf_srclines(cuDie, &lines, &count, &err) != DW_DLV_OK) {
+        return;
+    }
+    // a file the line table names relatively is relative to the directory the unit was compiled in,
+    // not to wherever the analysis runs
+    std::filesystem::path compDir = attributeString(dbg, cuDie, DW_AT_comp_dir);
+    std::unordered_map<std::string, int> fileIds;
+    for (Dwarf_Signed i = 0; i < count; i++) {
+        Dwarf_Addr address;
+        Dwarf_Unsigned line;
+        char* file = nullptr;
+        if (dwarf_lineaddr(lines[i], &address, &err) != DW_DLV_OK ||
+            dwarf_lineno(lines[i], &line, &err) != DW_DLV_OK ||
+            dwarf_linesrc(lines[i], &file, &err) != DW_DLV_OK) {
+            continue;
+        }
+        auto inserted = fileIds.emplace(file, files.size());
+        if (inserted.second) {
+            std::filesystem::path path(file);
+            if (path.is_relative() && !compDir.empty()) {
+                path = (compDir / path).lexically_normal();
+            }
+            files.push_back(path.string());
+        }
+        dwarf_dealloc(dbg, file, DW_DLA_STRING);
+        if (line > 0) {
+            rows.push_back({address, (int)line, inserted.first->second});
+        }
+    }
+    dwarf_srclines_dealloc(dbg, lines, count);
+    std::stable_sort(rows.begin(), rows.end(), [](const LineRow& a, const LineRow& b) { return a.address < b.address; });
+}
+
+// the file and the start are those of the function's first row, the start moved up to the declaration line,
+// the end is the line of its last instruction before the high pc, like addr2line on the first and last
+// instruction; rows of inlined code carry the lines of the inlined function and are skipped
+static bool locateSubprogram(const Subprogram& subprogram, const std::vector<LineRow>& rows,
+                             const std::vector<std::string>& files, FunctionLocation& location) {
+    auto inlined = [&](uint64_t address) {
+        for (const auto& range : subprogram.inlined) {
+            if (address >= range.first && address < range.second) {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto row = std::lower_bound(rows.begin(), rows.end(), subprogram.lowPc,
+                                [](const LineRow& row, uint64_t address) { return row.address < address; });
+    const LineRow* first = nullptr;
+    const LineRow* last = nullptr;
+    for (; row != rows.end() && row->address < subprogram.highPc; row++) {
+        if (inlined(row->address)) {
+            continue;
+        }
+        if (first == nullptr) {
+            first = &*row;
+        }
+        if (row->file == first->file) {
+            last = &*row;
+        }
+    }
+    if (first == nullptr) {
+        return false;
+    }
+    // a declaration line below the first row comes from a declaration elsewhere, e.g. in a class body
+    int startLine = subprogram.declLine > 0 && subprogram.declLine <= first->line ? subprogram.declLine : first->line;
+    location = {files[first->file], startLine, std::max(last->line, startLine)};
+    return true;
+}
+
+// a Dwarf_Debug must not be shared between threads, every reader opens its own
+static bool openDwarf(const std::string& binary, int& fd, Dwarf_Debug& dbg) {
+    fd = open(binary.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error: unable to open file " << binary << std::endl;
+        return false;
+    }
+    Dwarf_Error err;
+    if (dwarf_init(fd, DW_DLC_READ, nullptr, nullptr, &dbg, &err) != DW_DLV_OK) {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+static void closeDwarf(int fd, Dwarf_Debug dbg) {
+    Dwarf_Error err;
+    dwarf_finish(dbg, &err);
+    close(fd);
+}
+
+// offsets of the compilation unit DIEs, only the unit headers are read
+static bool listCompilationUnits(const std::string& binary, std::vector<Dwarf_Off>& units) {
+    int fd;
+    Dwarf_Debug dbg;
+    if (!openDwarf(binary, fd, dbg)) {
+        std::cout << binary << " has no DWARF debug information" << std::endl;
+        return false;
+    }
+    Dwarf_Error err;
+    Dwarf_Unsigned cuLength;
+    while (dwarf_next_cu_header_b(dbg, &cuLength, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &err) == DW_DLV_OK) {
+        Dwarf_Die cuDie;
+        if (dwarf_siblingof(dbg, nullptr, &cuDie, &err) != DW_DLV_OK) {
+            continue;
+        }
+        Dwarf_Off offset;
+        if (dwarf_dieoffset(cuDie, &offset, &err) == DW_DLV_OK) {
+            units.push_back(offset);
+        }
+        dwarf_dealloc(dbg, cuDie, DW_DLA_DIE);
+    }
+    closeDwarf(fd, dbg);
+    return true;
+}
+
+static void readUnitRanges(Dwarf_Debug dbg, Dwarf_Off unit, std::vector<FunctionRange>& ranges) {
+    Dwarf_Error err;
+    Dwarf_Die cuDie;
+    if (dwarf_offdie_b(dbg, unit, 1, &cuDie, &err) != DW_DLV_OK) {
+        return;
+    }
+    // entries of .debug_ranges are relative to the unit's low pc
+    Dwarf_Addr cuBase = 0;
+    dwarf_lowpc(cuDie, &cuBase, &err);
+    std::vector<Subprogram> subprograms;
+    collectSubprograms(dbg, cuDie, cuBase, subprograms);
+    std::vector<LineRow> rows;
+    std::vector<std::string> files;
+    if (!subprograms.empty()) {
+        collectLines(dbg, cuDie, rows, files);
+    }
+    for (const auto& subprogram : subprograms) {
+        FunctionRange range = {subprogram.lowPc, subprogram.highPc, {}, subprogram.names};
+        if (locateSubprogram(subprogram, rows, files, range.location)) {
+            ranges.push_back(range);
+        }
+    }
+    dwarf_dealloc(dbg, cuDie, DW_DLA_DIE);
+}
+
+bool FunctionIndex::readerThreads = true;
+
+void FunctionIndex::disableReaderThreads() {
+    readerThreads = false;
+}
+
+// the units are handed out one by one to a pool of readers, each with its own Dwarf_Debug,
+// and the per-unit results are concatenated in unit order so the index does not depend on scheduling
+static bool readDwarfRanges(const std::string& binary, bool threaded, std::vector<FunctionRange>& ranges) {
+    std::vector<Dwarf_Off> units;
+    if (!listCompilationUnits(binary, units)) {
+        return false;
+    }
+    std::vector<std::vector<FunctionRange>> unitRanges(units.size());
+    std::atomic<size_t> nextUnit(0);
+    auto reader = [&]() {
+        int fd;
+        Dwarf_Debug dbg;
+        if (!openDwarf(binary, fd, dbg)) {
+            return;
+        }
+        for (size_t unit = nextUnit++; unit < units.size(); unit = nextUnit++) {
+            readUnitRanges(dbg, units[unit], unitRanges[unit]);
+        }
+        closeDwarf(fd, dbg);
+    };
+    size_t threadCount = threaded ? std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), units.size()) : 1;
+    std::vector<std::thread> readers;
+    for (size_t i = 1; i < threadCount; i++) {
+        readers.emplace_back(reader);
+    }
+    reader();
+    for (auto& thread : readers) {
+        thread.join();
+    }
+    std::cout << "Read " << units.size() << " compilation units with " << std::max<size_t>(threadCount, 1) << " threads" << std::endl;
+    for (auto& unit : unitRanges) {
+        ranges.insert(ranges.end(), std::make_move_iterator(unit.begin()), std::make_move_iterator(unit.end()));
+    }
+    return true;
+}
+
+FunctionIndex::FunctionIndex() {
+    this->debugInfo = false;
+}
+
+bool FunctionIndex::build(const std::string& binary) {
+    std::string build_id = readBuildId(binary);
+    if (build_id.empty()) {
+        return false;
+    }
+    std::filesystem::path directory = std::filesystem::path(binary).parent_path();
+    std::string path = (directory.empty() ? std::filesystem::path(".") : directory) / (build_id + ".pfindex");
+    if (load(path, build_id)) {
+        std::cout << "Loaded " << this->functions.size() << " function names from " << path << std::endl;
+        return true;
+    }
+    if (!buildFromDwarf(binary)) {
+        return false;
+    }
+    save(path, build_id);
+    return true;
+}
+
+bool FunctionIndex::buildFromDwarf(const std::string& binary) {
+    std::vector<FunctionRange> ranges;
+    this->debugInfo = readDwarfRanges(binary, readerThreads, ranges) && !ranges.empty();
+    if (!this->debugInfo) {
+        return false;
+    }
+    // a name seen twice (e.g. static functions of two files) keeps its first definition, like nm | grep did
+    for (const auto& range : ranges) {
+        for (const auto& name : range.names) {
+            this->functions.emplace(name, range.location);
+        }
+    }
+
+    // symbols are matched to the function whose code they point into
+    std::sort(ranges.begin(), ranges.end(), [](const FunctionRange& a, const FunctionRange& b) { return a.lowPc < b.lowPc; });
+    std::vector<ElfSymbol> symbols;
+    readFunctionSymbols(binary, symbols);
+    for (const auto& symbol : symbols) {
+        auto next = std::upper_bound(ranges.begin(), ranges.end(), symbol.address,
+                                     [](uint64_t address, const FunctionRange& range) { return address < range.lowPc; });
+        if (next == ranges.begin()) {
+            continue;
+        }
+        const FunctionRange& range = *(next - 1);
+        if (symbol.address < range.highPc) {
+            this->functions.emplace(symbol.name, range.location);
+        }
+    }
+    std::cout << "Indexed " << this->functions.size() << " function names of " << binary << std::endl;
+    return true;
+}
+
+bool FunctionIndex::load(const std::string& path, const std::string& build_id) {
+    MappedFile file;
+    if (!file.open(path, sizeof(FunctionIndexHeader))) {
+        return false;
+    }
+    const char* mapping = file.data();
+    const FunctionIndexHeader* h = (const FunctionIndexHeader*)mapping;
+    const char* strings = mapping + h->stringTableOffset;
+    bool valid = memcmp(h->magic, FUNCTION_INDEX_MAGIC, sizeof(FUNCTION_INDEX_MAGIC)) == 0 &&
+                 h->version == FUNCTION_INDEX_VERSION &&
+                 file.sectionFits(h->entriesOffset, h->entryCount, sizeof(FunctionIndexEntry)) &&
+                 file.stringTableFits(h->stringTableOffset, h->stringTableSize) &&
+                 h->buildId < h->stringTableSize && build_id == strings + h->buildId;
+    if (!valid) {
+        std::cerr << "Error: ignoring invalid function index " << path << std::endl;
+        return false;
+    }
+    const FunctionIndexEntry* entries = (const FunctionIndexEntry*)(mapping + h->entriesOffset);
+    this->functions.reserve(h->entryCount);
+    for (uint32_t i = 0; i < h->entryCount; i++) {
+        if (entries[i].name >= h->stringTableSize || entries[i].file >= h->stringTableSize) {
+            continue;
+        }
+        this->functions.emplace(strings + entries[i].name,
+                                FunctionLocation{strings + entries[i].file, entries[i].startLine, entries[i].endLine});
+    }
+    this->debugInfo = true;
+    return true;
+}
+
+bool FunctionIndex::save(const std::string& path, const std::string& build_id) {
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> stringOffsets;
+    auto addString = [&](const std::string& value) {
+        auto it = stringOffsets.find(value);
+        if (it != stringOffsets.end()) {
+            return it->second;
+        }
+        uint32_t offset = strings.size();
+        strings.append(value);
+        strings.push_back('\0');
+        stringOffsets.emplace(value, offset);
+        return offset;
+    };
+    std::vector<FunctionIndexEntry> entries;
+    for (const auto& [name, location] : this->functions) {
+        entries.push_back({addString(name), addString(location.file), location.startLine, location.endLine});
+    }
+
+    FunctionIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FUNCTION_INDEX_MAGIC, sizeof(FUNCTION_INDEX_MAGIC));
+    header.version = FUNCTION_INDEX_VERSION;
+    header.entryCount = entries.size();
+    header.buildId = addString(build_id);
+    header.stringTableSize = strings.size();
+    header.entriesOffset = alignSection(sizeof(header));
+    header.stringTableOffset = alignSection(header.entriesOffset + entries.size() * sizeof(FunctionIndexEntry));
+
+    // the directory of the binary may not be writable, the index is then rebuilt every run
+    AtomicFileWriter file;
+    if (!file.open(path)) {
+        std::cout << "Unable to cache the function index at " << path << std::endl;
+        return false;
+    }
+    file.put(0, &header, sizeof(header));
+    file.put(header.entriesOffset, entries.data(), entries.size() * sizeof(FunctionIndexEntry));
+    file.put(header.stringTableOffset, strings.data(), strings.size());
+    if (!file.commit()) {
+        std::cerr << "Error: unable to write function index " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FunctionIndex::lookup(const std::string& name, FunctionLocation& location) {
+    auto it = this->functions.find(name);
+    if (it == this->functions.end()) {
+        return false;
+    }
+    location = it->second;
+    return true;
+}
+
+bool FunctionIndex::hasDebugInfo() {
+    return this->debugInfo;
+}
+
+size_t FunctionIndex::size() {
+    return this->functions.size();
+}
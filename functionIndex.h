@@ -0,0 +1,66 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_FUNCTIONINDEX_H
+#define DYNAMORIO_FUNCTIONINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The finished index is cached next to the binary as <build-id>.pfindex:
+//   header | entries | string table
+// laid out like the graph file, so a later run maps it instead of reading DWARF again.
+#define FUNCTION_INDEX_MAGIC "PFINDEX"
+#define FUNCTION_INDEX_VERSION 3
+
+struct FunctionIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t buildId;              // offset of the build-id in the string table
+    uint32_t stringTableSize;
+    uint64_t entriesOffset;        // FunctionIndexEntry[entryCount]
+    uint64_t stringTableOffset;
+};
+
+struct FunctionIndexEntry {
+    uint32_t name;
+    uint32_t file;
+    int32_t startLine;
+    int32_t endLine;
+};
+
+struct FunctionLocation {
+    std::string file;
+    int startLine;
+    int endLine;
+};
+
+// name -> source location of every function of one binary, built once from the ELF
+// symbol table and the DWARF subprograms and line tables, read in-process with libdwarf.
+// Compilation units are read in parallel, each reader thread with its own Dwarf_Debug, except in
+// processes that must not start threads of their own, such as the DynamoRIO client.
+// Functions are found under their DWARF name, their linkage name and their ELF symbol name.
+class FunctionIndex {
+private:
+    std::unordered_map<std::string, FunctionLocation> functions;
+    bool debugInfo;
+    bool buildFromDwarf(const std::string& binary);
+    bool load(const std::string& path, const std::string& build_id);
+    bool save(const std::string& path, const std::string& build_id);
+    static bool readerThreads;
+public:
+    FunctionIndex();
+    // reads all compilation units on the calling thread from now on
+    static void disableReaderThreads();
+    bool build(const std::string& binary);
+    bool lookup(const std::string& name, FunctionLocation& location);
+    bool hasDebugInfo();
+    size_t size();
+};
+
+
+#endif //DYNAMORIO_FUNCTIONINDEX_H
@@ -4,14 +4,27 @@
 //
 
 #include "graph.h"
+#include <deque>
 #include <iostream>
 
 using namespace std;
-Graph::Graph() {
+Graph::Graph() : names(&arena) {
     this->size = 0;
+    this->crashThread = -1;
+    this->functionCacheLookups = 0;
+    this->summaryRuns = 0;
+    this->summarySkips = 0;
+    this->projectIndexHits = 0;
+    // frames that never carry application data flow: sanitizer runtime, PLT stubs and crt helpers
+    this->contractionRules.prefixes = {"__asan_", "__sanitizer_", "__interceptor_", "__lsan_", "__ubsan_"};
+    this->contractionRules.suffixes = {"@plt"};
+    this->contractionRules.names = {"frame_dummy", "register_tm_clones", "deregister_tm_clones",
+                                    "__do_global_dtors_aux", "__libc_csu_init", "_init", "_fini"};
+    this->contractionRules.collapsePassThrough = false;
 }
 
 Graph::~Graph() {
+    // nothing to free one by one, the arena releases every node and name at once
 }
 
 
@@ -19,6 +32,8 @@ Graph::~Graph() {
 
 
 void Graph::addCall(const char* caller, const char* callee) {
+    // any new edge can change which nodes lie between the entry and a sink
+    this->clearPathCaches();
     Node* callerNode = this->findNode(caller);
     Node* calleeNode = this->findNode(callee);
     //std::cout << "Adding call from " << caller << " to " << callee << std::endl;
@@ -34,13 +49,31 @@ void Graph::addCall(const char* caller, const char* callee) {
     //std::cout << "Adding call from " << caller << " to " << callee << " done" << std::endl;
 }
 
+void Graph::addCall(const char* caller, const char* callee, int count) {
+    this->clearPathCaches();
+    Node* callerNode = this->findNode(caller);
+    if (callerNode == NULL) {
+        callerNode = this->createNode(this->names.intern(caller));
+    }
+    Node* calleeNode = this->findNode(callee);
+    if (calleeNode == NULL) {
+        calleeNode = this->createNode(this->names.intern(callee));
+    }
+    callerNode->add_next(calleeNode, count);
+}
+
+void Graph::addCallOnThread(const char* caller, const char* callee, uint32_t thread) {
+    addCall(caller, callee);
+    this->findNode(caller)->add_thread_calls(this->findNode(callee), thread, 1);
+}
+
 
 
 void Graph::printGraph() {
 
     for (int  i = 0; i < this->list.size(); i++) {
 
-        std::vector<Node*> nodes = this->list[i]->get_next();
+        const auto& nodes = this->list[i]->get_next();
         if (nodes.size() == 0) {
             continue;
         }
@@ -54,6 +87,119 @@ void Graph::printGraph() {
     }
 }
 
+bool Graph::saveBinary(std::string graph_file) {
+    GraphFileWriter writer;
+    std::unordered_map<Node*, uint32_t> ids;
+    for (size_t i = 0; i < this->list.size(); i++) {
+        ids[this->list[i]] = i;
+    }
+    writer.rowOffsets.push_back(0);
+    for (Node* node : this->list) {
+        writer.names.push_back(writer.addString(node->get_name()));
+        writer.callCounts.push_back(node->get_call_count());
+        const auto& nodes = node->get_next();
+        const auto& counts = node->get_next_call_count();
+        for (size_t j = 0; j < nodes.size(); j++) {
+            writer.edgeThreads.push_back(writer.threadTags.size());
+            writer.edgeTargets.push_back(ids[nodes[j]]);
+            writer.edgeCounts.push_back(counts[j]);
+            for (const auto& tag : node->get_threads(nodes[j])) {
+                writer.threadTags.push_back({tag.thread, tag.count});
+            }
+        }
+        writer.rowOffsets.push_back(writer.edgeTargets.size());
+    }
+    writer.edgeThreads.push_back(writer.threadTags.size());
+    for (const auto& info : this->backtrace) {
+        GraphFileFrame frame = {writer.addString(info.function_name), writer.addString(info.file_name), info.line_number, info.thread};
+        writer.frames.push_back(frame);
+    }
+    writer.crashThread = this->crashThread;
+    std::cout << "Saving graph with " << writer.names.size() << " nodes and "
+              << writer.edgeTargets.size() << " edges to " << graph_file << std::endl;
+    return writer.write(graph_file);
+}
+
+bool Graph::loadBinary(std::string graph_file) {
+    std::unique_ptr<GraphFile> mapped(new GraphFile());
+    if (!mapped->open(graph_file)) {
+        return false;
+    }
+    // names are used in place from the mapping, which stays open as long as the graph
+    std::vector<Node*> nodes(mapped->nodeCount());
+    for (uint32_t i = 0; i < mapped->nodeCount(); i++) {
+        std::string_view name = this->names.adopt(mapped->nodeName(i));
+        nodes[i] = this->findNode(name.data());
+        if (nodes[i] == NULL) {
+            nodes[i] = this->createNode(name);
+        }
+    }
+    for (uint32_t i = 0; i < mapped->nodeCount(); i++) {
+        for (uint32_t e = mapped->edgeBegin(i); e < mapped->edgeEnd(i); e++) {
+            Node* target = nodes[mapped->edgeTarget(e)];
+            nodes[i]->add_next(target, mapped->edgeCallCount(e));
+            for (uint32_t t = mapped->edgeThreadBegin(e); t < mapped->edgeThreadEnd(e); t++) {
+                nodes[i]->add_thread_calls(target, mapped->threadTag(t).thread, mapped->threadTag(t).count);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < mapped->backtraceCount(); i++) {
+        const GraphFileFrame& frame = mapped->frame(i);
+        FunctionInfo info;
+        info.function_name = this->names.adopt(mapped->string(frame.functionName));
+        info.file_name = this->names.adopt(mapped->string(frame.fileName));
+        info.line_number = frame.lineNumber;
+        info.thread = frame.thread;
+        this->backtrace.push_back(info);
+    }
+    if (mapped->crashThread() >= 0) {
+        this->crashThread = mapped->crashThread();
+    }
+    this->clearPathCaches();
+    this->mappedFiles.push_back(std::move(mapped));
+    return true;
+}
+
+bool Graph::loadText(std::string graph_text_file) {
+    std::ifstream file(graph_text_file);
+    if (!file.is_open()) {
+        std::cerr << "Error: unable to open file " << graph_text_file << std::endl;
+        return false;
+    }
+
+    // same layout as printGraph: "Node <caller>" followed by "<callee> <count>" lines, blank line ends a caller
+    std::string line;
+    Node* caller = NULL;
+    while (std::getline(file, line)) {
+        std::vector<std::string> parts = splitBySpace(line);
+        if (parts.empty()) {
+            caller = NULL;
+            continue;
+        }
+        if (parts.size() != 2) {
+            continue;
+        }
+        bool isCount = std::all_of(parts[1].begin(), parts[1].end(), ::isdigit);
+        if (parts[0] == "Node" && !isCount) {
+            caller = this->findNode(parts[1].c_str());
+            if (caller == NULL) {
+                this->addNode(parts[1].c_str());
+                caller = this->findNode(parts[1].c_str());
+            }
+        } else if (caller != NULL && isCount) {
+            Node* callee = this->findNode(parts[0].c_str());
+            if (callee == NULL) {
+                this->addNode(parts[0].c_str());
+                callee = this->findNode(parts[0].c_str());
+            }
+            caller->add_next(callee, std::stoi(parts[1]));
+        }
+    }
+    file.close();
+    this->clearPathCaches();
+    return true;
+}
+
 void Graph::loadDefineJson(std::string define_json_file) {
     std::ifstream file(define_json_file);
     if (!file.is_open()) {
@@ -72,34 +218,99 @@ void Graph::loadDefineJson(std::string define_json_file) {
     file.close();
 }
 
-void Graph::loadPollutionInfo(std::string pollution_info_file) {
+bool Graph::loadPollutionInfo(std::string pollution_info_file, bool replace) {
     std::ifstream file(pollution_info_file);
     if (!file.is_open()) {
         std::cerr << "Error: unable to open file " << pollution_info_file << std::endl;
-        return;
+        return false;
     }
 
-    nlohmann::json j;
-    file >> j;
+    // the daemon reloads this file on request, a malformed one is reported and leaves the loaded info alone
+    nlohmann::json j = nlohmann::json::parse(file, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) {
+        std::cerr << "Error: unable to parse pollution info " << pollution_info_file << std::endl;
+        return false;
+    }
+    auto readNames = [](const nlohmann::json& entry, const char* field, std::set<std::string>& names) {
+        if (!entry.contains(field)) {
+            return true;
+        }
+        const nlohmann::json& values = entry[field];
+        if (!values.is_array()) {
+            return false;
+        }
+        for (const auto& value : values) {
+            if (!value.is_string()) {
+                return false;
+            }
+            names.insert(value.get<std::string>());
+        }
+        return true;
+    };
+    std::map<std::string, PollutionInfo> infos;
     for (const auto& item : j.items()) {
-        std::string key = item.key();
         PollutionInfo info;
-        for (const auto& var : item.value()["var"]) {
-            info.var.insert(var);
+        if (!item.value().is_object() || !readNames(item.value(), "var", info.var) ||
+            !readNames(item.value(), "index", info.index)) {
+            std::cerr << "Error: malformed pollution info for " << item.key() << " in " << pollution_info_file << std::endl;
+            return false;
         }
-        for (const auto& index : item.value()["index"]) {
-            info.index.insert(index);
+        infos[item.key()] = info;
+    }
+    if (replace) {
+        this->pollutionInfos.clear();
+    }
+    for (auto& [key, info] : infos) {
+        this->pollutionInfos[key] = info;
+    }
+    return true;
+}
+
+void Graph::loadSinks(std::string sink_file) {
+    std::ifstream file(sink_file);
+    if (!file.is_open()) {
+        std::cerr << "Error: unable to open file " << sink_file << std::endl;
+        return;
+    }
+
+    // one function name per line, lines starting with # are comments
+    std::string line;
+    while (std::getline(file, line)) {
+        std::vector<std::string> parts = splitBySpace(line);
+        if (parts.empty() || parts[0][0] == '#') {
+            continue;
         }
-        pollutionInfos[key] = info;
+        addSink(parts[0]);
     }
     file.close();
 }
 
-std::unordered_map<Node*, Path> Graph::reverseGraph() {
+void Graph::addSink(std::string sink) {
+    // the ASan frame of an intercepted call is named after the interceptor,
+    // but the graph only knows the intercepted function after removeInterceptors
+    if (sink.find("__interceptor_") == 0) {
+        sink = sink.substr(14);
+    }
+    std::cout << "Adding sink " << sink << std::endl;
+    sinks.insert(sink);
+}
+
+void Graph::addBacktraceSink() {
+    // addBacktrace leaves the frames innermost last, so a saved report ends in frame #0 of the bad access
+    if (!this->backtrace.empty()) {
+        addSink(std::string(this->backtrace.back().function_name));
+    }
+}
+
+std::unordered_map<Node*, Path> Graph::reverseGraph(int thread) {
+    // with a thread given, only the edges that thread made (or untagged ones) are kept
     std::unordered_map<Node*, Path> reversed;
     std::cout << "Constructing Reversed Graph" << std::endl;
     for (Node* node : this->list) {
         for (Node* adj : node->get_next()) {
+            if (thread >= 0 && !node->has_thread(adj, thread)) {
+                continue;
+            }
             reversed[adj].push_back(node);
         }
         if (reversed.find(node) == reversed.end()) {
@@ -110,8 +321,111 @@ std::unordered_map<Node*, Path> Graph::reverseGraph() {
     return reversed;
 }
 
+const std::unordered_map<Node*, Path>& Graph::cachedReverseGraph(int thread) {
+    auto cached = this->reversedGraphs.find(thread);
+    if (cached != this->reversedGraphs.end()) {
+        return cached->second;
+    }
+    return this->reversedGraphs[thread] = reverseGraph(thread);
+}
+
+const std::unordered_set<Node*>& Graph::cachedEntryReachable(Node* entry, int thread) {
+    auto key = std::make_pair(entry, thread);
+    auto cached = this->entryReachable.find(key);
+    if (cached != this->entryReachable.end()) {
+        return cached->second;
+    }
+    return this->entryReachable[key] = forwardReachable({entry}, thread);
+}
+
+const std::unordered_set<Node*>& Graph::cachedRootReachable(int thread) {
+    auto cached = this->rootReachable.find(thread);
+    if (cached != this->rootReachable.end()) {
+        return cached->second;
+    }
+    // a backward search stops at main and at nodes without callers, so one traversal
+    // from all of them gives every node the search can still turn into a chain
+    std::vector<Node*> roots;
+    for (const auto& entry : cachedReverseGraph(thread)) {
+        if (entry.second.empty() || entry.first->get_name() == "main") {
+            roots.push_back(entry.first);
+        }
+    }
+    return this->rootReachable[thread] = forwardReachable(roots, thread);
+}
+
+void Graph::clearPathCaches() {
+    this->reversedGraphs.clear();
+    this->prunedGraphs.clear();
+    this->entryReachable.clear();
+    this->rootReachable.clear();
+}
+
+std::unordered_set<Node*> Graph::forwardReachable(const std::vector<Node*>& entries, int thread) {
+    std::unordered_set<Node*> reachable(entries.begin(), entries.end());
+    std::vector<Node*> worklist = entries;
+    while (!worklist.empty()) {
+        Node* node = worklist.back();
+        worklist.pop_back();
+        for (Node* next : node->get_next()) {
+            if (thread >= 0 && !node->has_thread(next, thread)) {
+                continue;
+            }
+            if (reachable.insert(next).second) {
+                worklist.push_back(next);
+            }
+        }
+    }
+    return reachable;
+}
+
+const std::unordered_map<Node*, Path>& Graph::prunedGraph(Node* entry, Node* sink,
+                                                          const std::unordered_map<Node*, Path>& reversed, int thread) {
+    auto key = std::make_tuple(entry, sink, thread);
+    auto cached = this->prunedGraphs.find(key);
+    if (cached != this->prunedGraphs.end()) {
+        return cached->second;
+    }
+
+    // only nodes that are reachable from the entry and can reach the sink can be on a chain,
+    // an empty result means the sink is not reachable from the entry at all
+    const std::unordered_set<Node*>& forward = cachedEntryReachable(entry, thread);
+    std::unordered_map<Node*, Path>& pruned = this->prunedGraphs[key];
+    if (forward.find(sink) == forward.end()) {
+        return pruned;
+    }
+
+    // walk backward from the sink, keeping only the predecessors the entry can reach
+    std::vector<Node*> worklist = {sink};
+    pruned[sink];
+    while (!worklist.empty()) {
+        Node* node = worklist.back();
+        worklist.pop_back();
+        if (node == entry) {
+            continue;
+        }
+        for (Node* prev : reversed.at(node)) {
+            if (forward.find(prev) == forward.end()) {
+                continue;
+            }
+            pruned[node].push_back(prev);
+            if (pruned.find(prev) == pruned.end()) {
+                pruned[prev];
+                worklist.push_back(prev);
+            }
+        }
+    }
+    std::cout << "Pruned graph for " << entry->get_name() << " -> " << sink->get_name() << ": "
+              << pruned.size() << " of " << reversed.size() << " nodes" << std::endl;
+    return pruned;
+}
+
 void Graph::dfs(Node* node, Path& path, std::vector<Path>& allPaths,
-         const std::unordered_map<Node*, Path>& reversed, std::vector<Node*>& visited ) {
+         const std::unordered_map<Node*, Path>& reversed, const std::unordered_set<Node*>& reachable) {
+    // a node no chain start can reach only leads back into cycles, it is never walked
+    if (reachable.find(node) == reachable.end()) {
+        return;
+    }
     //if there are more than one time the same node in the path, return
     // we only allow the cycle to be executed once
     if (std::count(path.begin(), path.end(), node) > 1) {
@@ -126,102 +440,225 @@ void Graph::dfs(Node* node, Path& path, std::vector<Path>& allPaths,
         allPaths.push_back(std::vector<Node*>(path.rbegin(), path.rend()));
     } else {
         for (Node* prev : reversed.at(node)) {
-            dfs(prev, path, allPaths, reversed, visited);
+            dfs(prev, path, allPaths, reversed, reachable);
         }
     }
 
     path.pop_back();
 }
 
-std::vector<Path> Graph::findAllCallChains(Node* target) {
-    auto reversed = reverseGraph();
-    Path currentPath;
-    std::vector<Node*> visited;
-    std::vector<Path> allPaths;
-    dfs(target, currentPath, allPaths, reversed, visited);
-    return allPaths;
+std::vector<CallChain> Graph::findAllCallChains(const std::vector<Node*>& targets, int thread) {
+    // the reversed graph and the reachability sets are cached until the graph changes and shared by all sinks
+    const std::unordered_map<Node*, Path>& reversed = cachedReverseGraph(thread);
+    const std::unordered_set<Node*>& reachable = cachedRootReachable(thread);
+    std::vector<CallChain> allChains;
+    Node* entry = this->findNode("main");
+    for (Node* target : targets) {
+        // enumerate on the subgraph between main and the sink when there is one,
+        // sinks only reachable from other roots (e.g. thread start routines) use the whole graph
+        const std::unordered_map<Node*, Path>* searchGraph = &reversed;
+        if (entry != NULL) {
+            const std::unordered_map<Node*, Path>& pruned = prunedGraph(entry, target, reversed, thread);
+            if (!pruned.empty()) {
+                searchGraph = &pruned;
+            } else {
+                std::cout << target->get_name() << " is not reachable from main, searching the whole graph" << std::endl;
+            }
+        }
+        Path currentPath;
+        std::vector<Path> allPaths;
+        dfs(target, currentPath, allPaths, *searchGraph, reachable);
+        for (auto& path : allPaths) {
+            allChains.push_back({std::string(target->get_name()), path});
+        }
+    }
+    return allChains;
 }
 
 Node* Graph::findNode(const char* name) {
-    for (int i = 0; i < this->size; i++) {
-        if (this->list[i]->get_name() == name) {
-            return this->list[i];
-        }
+    auto it = this->index.find(name);
+    if (it == this->index.end()) {
+        return NULL;
     }
-    return NULL;
+    return it->second;
 }
 
 void Graph::Traversal(const char *binary_name)  {
 
     // extract the function sequence
     StaticAnalyzer analyzer;
+    if (!this->taintStateFile.empty()) {
+        analyzer.loadTaintState(this->taintStateFile);
+    }
+    refreshSources(analyzer);
+    // fold runtime wrappers and stubs away before any path work
+    contractGraph();
     std::cout << "Backward Traversal" << std::endl;
 
-    //TODO: find the crash point and extract source to put into the taintMap
-    Node* target = this->findNode("strcpy");
+    // the sinks come from the ASan report or the sink file, strcpy is the fallback
+    if (sinks.empty()) {
+        sinks.insert("strcpy");
+    }
+    std::vector<Node*> targets;
+    for (const auto& sink : sinks) {
+        Node* target = this->findNode(sink.c_str());
+        if (target == NULL) {
+            std::cout << "Sink " << sink << " not found" << std::endl;
+            continue;
+        }
+        targets.push_back(target);
+    }
 
-    if (target == NULL) {
+    if (targets.empty()) {
         std::cout << "Target not found" << std::endl;
         return;
     }
-    std::vector<Path> allPaths = findAllCallChains(target);
+    // chains mixing calls of different threads are not real, so stay on the crashing thread when known
+    std::vector<CallChain> allChains;
+    if (this->crashThread >= 0) {
+        std::cout << "Restricting call chains to thread T" << this->crashThread << std::endl;
+        allChains = findAllCallChains(targets, this->crashThread);
+    }
+    if (allChains.empty()) {
+        allChains = findAllCallChains(targets);
+    }
     // print the function sequences
-    for (int i = 0; i < allPaths.size(); i++) {
-        for (int j = 0; j < allPaths[i].size(); j++) {
-            std::cout << allPaths[i][j]->get_name() << " -> ";
+    for (size_t i = 0; i < allChains.size(); i++) {
+        std::cout << "[" << allChains[i].sink << "] ";
+        for (size_t j = 0; j < allChains[i].path.size(); j++) {
+            std::cout << allChains[i].path[j]->get_name() << " -> ";
         }
         std::cout << std::endl;
     }
 
     // Do backward traversal with srcML
-    TaintMap taintMap;
+    TaintMap taintMap = pollutionTaintMap(analyzer);
+    clearFunctionSummaries();
 
 //    taintMap["_tinydir_strcpy"].first = {"dir_name_buf", "path"};
 //    taintMap["_tinydir_strcpy"].second = {"#0","#1"};
 
-    for (auto it = pollutionInfos.begin(); it != pollutionInfos.end(); it++) {
-        std::string var = it->first;
-        PollutionInfo info = it->second;
-        taintMap[var].first = info.var;
-        taintMap[var].second = info.index;
-    }
 
-
-    for (int i = 0; i < allPaths.size(); i++) {
-        visitPath(allPaths[i], analyzer, binary_name, taintMap, false);
+    for (size_t i = 0; i < allChains.size(); i++) {
+        visitPath(allChains[i].path, analyzer, binary_name, taintMap, false);
     }
 
     std::cout << "\n\n\n\n\nForward Traversal" << std::endl;
     // Do forward traversal with srcML
-    for (int i = 0; i < allPaths.size(); i++) {
-        visitPath(allPaths[i], analyzer, binary_name, taintMap, true);
+    for (size_t i = 0; i < allChains.size(); i++) {
+        visitPath(allChains[i].path, analyzer, binary_name, taintMap, true);
+    }
+    std::cout << "Function cache: " << this->functionElementCache.size() << " functions parsed for "
+              << this->functionCacheLookups << " visits" << std::endl;
+    if (this->projectIndex != NULL) {
+        std::cout << "Project index: " << this->projectIndexHits << " functions found" << std::endl;
+    }
+    std::cout << "Taint memo: " << analyzer.getTaintMemoHits() << " hits, "
+              << analyzer.getTaintMemoMisses() << " misses" << std::endl;
+    if (!this->taintStateFile.empty()) {
+        std::cout << "Taint state: " << analyzer.getTaintStateReused() << " results reused from the previous run" << std::endl;
+        analyzer.saveTaintState(this->taintStateFile);
+    }
+    if (this->functionCache != NULL) {
+        std::cout << "Persistent function cache: " << this->functionCache->getHits() << " hits, "
+                  << this->functionCache->getMisses() << " misses" << std::endl;
     }
 }
 
-std::vector<CodeElement> Graph::awkElementExtraction(std::string file_name, StaticAnalyzer& analyzer, int start_line_number, int end_column_number) {
-    //  use awk to extract the source code of the function
-    //         then preprocess the code to remove comments etc.
-    std::string awk_command = "awk 'NR>=" + std::to_string(start_line_number) + " && NR<=" + std::to_string(end_column_number) + "' " + file_name;
-    std::string awk_output = analyzer.exec(awk_command.c_str());
-//    std::cout << "awk command: " << awk_command << std::endl;
-//    std::cout << "awk output: " << awk_output << std::endl;
-    //strip the leading meaningless characters, start with the definition of the function
-    size_t pos = awk_output.find_first_not_of('}');
-    if (pos != std::string::npos) {
-        awk_output = awk_output.substr(pos);
+void Graph::setFunctionCacheDir(std::string function_cache_dir) {
+    std::unique_ptr<FunctionCache> cache(new FunctionCache(function_cache_dir));
+    if (cache->isUsable()) {
+        this->functionCache = std::move(cache);
     }
-    awk_output = analyzer.preprocessCode(awk_output);
+}
 
-    // parse the source code of the function with srcML
-    std::string command = "echo \"" + awk_output + "\" | srcml --language=C++ --position  ";
-    std::string srcml_output = analyzer.exec(command.c_str());
+void Graph::setTaintStateFile(std::string taint_state_file) {
+    this->taintStateFile = taint_state_file;
+}
 
-    // parse the srcML output to get the effected elements
-    xmlDocPtr doc = xmlReadMemory(srcml_output.c_str(), srcml_output.size(), NULL, NULL, 0);
-    xmlNodePtr root_element = xmlDocGetRootElement(doc);
+bool Graph::loadProjectIndex(std::string project_index_file) {
+    std::unique_ptr<ProjectIndex> index(new ProjectIndex());
+    if (!index->open(project_index_file)) {
+        return false;
+    }
+    std::cout << "Loaded " << index->functionCount() << " functions from " << project_index_file << std::endl;
+    this->projectIndex = std::move(index);
+    return true;
+}
 
-    std::vector<CodeElement> elements = analyzer.parseElements(root_element);
-    return elements;
+TaintMap Graph::pollutionTaintMap(StaticAnalyzer& analyzer) {
+    TaintMap taintMap;
+    for (auto it = pollutionInfos.begin(); it != pollutionInfos.end(); it++) {
+        analyzer.addTaint(taintMap, it->first, it->second.var, it->second.index);
+    }
+    return taintMap;
+}
+
+const std::vector<CodeElement>* Graph::functionElements(const char *binary_name, StaticAnalyzer& analyzer, std::string function_name) {
+    // every function is located and parsed once per graph, whichever path or direction asks first,
+    // a function that could not be located is remembered as well
+    this->functionCacheLookups++;
+    auto located = this->functionLocations.find(function_name);
+    if (located == this->functionLocations.end()) {
+        // Step 1: get the location of the function in the source code from the binary,
+        //         the project index only stands in for parsing the definition found there
+        located = this->functionLocations.emplace(function_name, analyzer.getFunctionInfo(binary_name, function_name)).first;
+    }
+    const std::tuple<std::string, int, int>& func_info = located->second;
+    if (std::get<0>(func_info) == "") {
+        return NULL;
+    }
+
+    auto parsed = this->functionElementCache.find(func_info);
+    if (parsed == this->functionElementCache.end()) {
+        std::string file_name = std::get<0>(func_info);
+        this->sources.watch(file_name);
+        int start_line_number = std::get<1>(func_info);
+        int end_column_number = std::get<2>(func_info);
+        // a function whose file is unchanged since an earlier run is read back instead of parsed
+        std::vector<CodeElement> elements;
+        int64_t indexed = this->projectIndex == NULL ? -1 : this->projectIndex->findAt(function_name, file_name, start_line_number, end_column_number);
+        if (indexed >= 0) {
+            elements = this->projectIndex->elements(indexed);
+            this->projectIndexHits++;
+        } else if (this->functionCache == NULL || !this->functionCache->load(file_name, start_line_number, end_column_number, elements)) {
+            elements = sourceElementExtraction(file_name, analyzer, start_line_number, end_column_number);
+            // an empty result is most likely a failed parse and is not kept
+            if (this->functionCache != NULL && !elements.empty()) {
+                this->functionCache->store(file_name, start_line_number, end_column_number, elements);
+            }
+        }
+        parsed = this->functionElementCache.emplace(func_info, std::move(elements)).first;
+    }
+    return &parsed->second;
+}
+
+TaintMap Graph::taintFunction(const char *binary_name, StaticAnalyzer& analyzer, std::string function_name, const std::set<std::string>& params) {
+    // forward analysis of one function with the given parameters tainted, then of every callee they reach
+    refreshSources(analyzer);
+    TaintMap taintMap = pollutionTaintMap(analyzer);
+    analyzer.addTaint(taintMap, function_name, {}, params);
+    clearFunctionSummaries();
+    std::stack<std::pair<std::string, bool>> functionStack;
+    const std::vector<CodeElement>* elements = functionElements(binary_name, analyzer, function_name);
+    if (elements == NULL) {
+        std::cout << "Function " << function_name << " not found" << std::endl;
+        return taintMap;
+    }
+    analyzer.TaintAnalysis(*elements, taintMap, functionStack, this->definitions, this->list, function_name, "", true, true);
+    std::string previousFunction = function_name;
+    visitFunctionStack(functionStack, analyzer, binary_name, taintMap, previousFunction);
+    return taintMap;
+}
+
+std::vector<CodeElement> Graph::sourceElementExtraction(std::string file_name, StaticAnalyzer& analyzer, int start_line_number, int end_column_number) {
+    //  take the lines of the function from the source store
+    //         then preprocess the code to remove comments etc.
+    std::string_view body;
+    if (!this->sources.lines(file_name, start_line_number, end_column_number, body)) {
+        return {};
+    }
+    return analyzer.extractElements(body);
 }
 
 void Graph::visitPath(Path path, StaticAnalyzer& analyzer, const char *binary_name, TaintMap& taintMap, bool isForward) {
@@ -240,20 +677,13 @@ void Graph::visitPath(Path path, StaticAnalyzer& analyzer, const char *binary_na
             previousFunction = path[i+1]->get_name();
         }
         std::cout << "Visiting " << currentFunction << std::endl;
-        // Step 1: get the location of the function in the source code
-        std::tuple<std::string, int, int> func_info;
-        func_info = analyzer.getFunctionInfo(binary_name, currentFunction);
-        if (std::get<0>(func_info) == "") {
+        const std::vector<CodeElement>* elements = functionElements(binary_name, analyzer, currentFunction);
+        if (elements == NULL) {
             previousFunction = currentFunction;
             continue;
         }
-        std::string file_name = std::get<0>(func_info);
-        int start_line_number = std::get<1>(func_info);
-        int end_column_number = std::get<2>(func_info);
-
-        std::vector<CodeElement> elements = awkElementExtraction( file_name, analyzer, start_line_number, end_column_number);
-        std::cout << "elements size: " << elements.size() << std::endl;
-        analyzer.TaintAnalysis(elements, taintMap, functionStack, this->definitions, this->list, currentFunction, previousFunction, isForward);
+        std::cout << "elements size: " << elements->size() << std::endl;
+        analyzer.TaintAnalysis(*elements, taintMap, functionStack, this->definitions, this->list, currentFunction, previousFunction, isForward);
 
         if (isForward == false) {
             previousFunction = currentFunction;
@@ -262,43 +692,144 @@ void Graph::visitPath(Path path, StaticAnalyzer& analyzer, const char *binary_na
 
 
     std::cout << "Function stack size: " << functionStack.size() << std::endl;
+    visitFunctionStack(functionStack, analyzer, binary_name, taintMap, previousFunction);
+}
 
+void Graph::refreshSources(StaticAnalyzer& analyzer) {
+    // the daemon answers queries for as long as it runs, so before each one every function taken from
+    // a source file that changed since is dropped from the caches and parsed again when it is visited
+    for (const auto& file : this->sources.refresh()) {
+        std::cout << "Reading " << file << " again, it changed since it was read" << std::endl;
+        for (auto it = this->functionElementCache.begin(); it != this->functionElementCache.end(); ) {
+            it = std::get<0>(it->first) == file ? this->functionElementCache.erase(it) : std::next(it);
+        }
+        for (const auto& [function, location] : this->functionLocations) {
+            if (std::get<0>(location) == file) {
+                analyzer.forgetFunction(function);
+            }
+        }
+        if (this->functionCache != NULL) {
+            this->functionCache->forgetFile(file);
+        }
+        if (this->projectIndex != NULL) {
+            this->projectIndex->forgetFile(file);
+        }
+    }
+}
+
+void Graph::clearFunctionSummaries() {
+    this->functionSummaries.clear();
+    this->summaryRuns = 0;
+    this->summarySkips = 0;
+}
 
+void Graph::visitFunctionStack(std::stack<std::pair<std::string, bool>>& functionStack, StaticAnalyzer& analyzer,
+                               const char *binary_name, TaintMap& taintMap, std::string previousFunction) {
+    // worklist over the callees: a function is analyzed again only when its own taint or the
+    // parameters of the caller it was reached from changed since its summary, until nothing changes
+    std::deque<SummaryKey> worklist;
+    std::set<SummaryKey> queued;
+    auto enqueue = [&](const SummaryKey& key) {
+        if (queued.insert(key).second) {
+            worklist.push_back(key);
+        }
+    };
+    // the pushes of the path itself, in the order the stack would have popped them
     while (!functionStack.empty()) {
-        std::string currentFunction = "";
-        bool isForward = false;
-        std::tie(currentFunction, isForward) = functionStack.top();
+        enqueue({functionStack.top().first, functionStack.top().second, previousFunction});
         functionStack.pop();
+    }
+
+    while (!worklist.empty()) {
+        SummaryKey key = worklist.front();
+        worklist.pop_front();
+        queued.erase(key);
+        const auto& [currentFunction, isForward, callerFunction] = key;
+        auto summary = this->functionSummaries.find(key);
+        if (summary != this->functionSummaries.end() && summary->second.output == taintMap[currentFunction] &&
+            summary->second.previousParams == taintMap[callerFunction].params) {
+            this->summarySkips++;
+            continue;
+        }
         std::cout << "Visiting " << currentFunction << std::endl;
-        // Step 1: get the location of the function in the source code
-        std::tuple<std::string, int, int> func_info;
-        func_info = analyzer.getFunctionInfo(binary_name, currentFunction);
-        if (std::get<0>(func_info) == "") {
-            previousFunction = currentFunction;
+        const std::vector<CodeElement>* elements = functionElements(binary_name, analyzer, currentFunction);
+        if (elements == NULL) {
             continue;
         }
-        std::string file_name = std::get<0>(func_info);
-        int start_line_number = std::get<1>(func_info);
-        int end_column_number = std::get<2>(func_info);
+        FunctionTaint input = taintMap[currentFunction];
+        TaintSet previousParams = taintMap[callerFunction].params;
+        std::stack<std::pair<std::string, bool>> pushed;
+        analyzer.TaintAnalysis(*elements, taintMap, pushed, this->definitions, this->list, currentFunction, callerFunction, isForward, true);
+        this->summaryRuns++;
 
-        std::vector<CodeElement> elements = awkElementExtraction(file_name, analyzer, start_line_number, end_column_number);
-        analyzer.TaintAnalysis(elements, taintMap, functionStack, this->definitions, this->list, currentFunction, previousFunction, isForward, true);
+        FunctionSummary& result = this->functionSummaries[key];
+        result.previousParams = previousParams;
+        result.output = taintMap[currentFunction];
+        result.callees.clear();
+        for (; !pushed.empty(); pushed.pop()) {
+            result.callees.push_back(pushed.top());
+            enqueue({pushed.top().first, pushed.top().second, currentFunction});
+        }
+        if (result.output != input) {
+            // the taint it produced is input for another pass over itself
+            enqueue(key);
+            // and for the functions reached from it, which read its parameters
+            if (result.output.params != input.params) {
+                for (const auto& [dependent, dependentSummary] : this->functionSummaries) {
+                    if (std::get<2>(dependent) == currentFunction) {
+                        enqueue(dependent);
+                    }
+                }
+            }
+        }
     }
+    std::cout << "Function summaries: " << this->summaryRuns << " analyses, " << this->summarySkips
+              << " skipped as unchanged" << std::endl;
 }
 
 void Graph::addNode(const char* name) {
     //std::cout << "Adding node " << name << std::endl;
-    Node* new_node = new Node();
+    createNode(this->names.intern(name));
+    //std::cout << "Adding node " << name << " done with size " << this->size << std::endl;
+}
+
+Node* Graph::createNode(std::string_view name) {
+    // name must already be in the pool
+    void* storage = this->arena.allocate(sizeof(Node), alignof(Node));
+    Node* new_node = new (storage) Node(&this->arena);
     new_node->set_name(name);
     this->list.push_back(new_node);
+    this->index.emplace(name, new_node);
     this->size++;
-    //std::cout << "Adding node " << name << " done with size " << this->size << std::endl;
+    return new_node;
 }
 
 int Graph::getSize() {
     return this->list.size();
 }
 
+const std::vector<Node*>& Graph::getNodes() {
+    return this->list;
+}
+
+bool Graph::hasBacktrace() {
+    return !this->backtrace.empty();
+}
+
+// the name removeInterceptors gives a function
+static std::string withoutInterceptor(std::string_view name) {
+    return std::string(name.find("__interceptor_") != std::string_view::npos ? name.substr(14) : name);
+}
+
+int Graph::getBacktraceCalls(std::string_view caller, std::string_view callee) {
+    auto it = this->backtraceCalls.find({withoutInterceptor(caller), withoutInterceptor(callee)});
+    return it == this->backtraceCalls.end() ? 0 : it->second;
+}
+
+int Graph::getCrashThread() {
+    return this->crashThread;
+}
+
 std::vector<std::string> Graph::splitBySpace(const std::string &line) {
     std::vector<std::string> tokens;
     std::istringstream stream(line);
@@ -317,9 +848,41 @@ void Graph::parseASanOutput(std::string asan_output_file) {
         return;
     }
     std::string line;
+    // every stack in the report is introduced by a line naming its thread,
+    // e.g. "WRITE of size 8 at 0x... thread T1" or "freed by thread T0 here:"
+    int stackThread = -1;
+    // the stacks of the deallocation, the allocation and the thread creation only lead to
+    // free, malloc or pthread_create, and the frame that owns an accessed stack variable is
+    // only where the memory lives; their frames are kept as edges but never become sinks
+    bool allocationStack = false;
     while (std::getline(file, line)) {
         // remove the leading spaces
-        line = line.substr(line.find_first_not_of(" \t"));
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            continue;
+        }
+        line = line.substr(start);
+        size_t thread_pos = line.find("thread T");
+        size_t creator_pos = line.find("created by T");
+        if (line.find("Thread T") == 0 && creator_pos != std::string::npos) {
+            // "Thread T1 created by T0 here:" is followed by the stack of the creating thread
+            stackThread = std::atoi(line.c_str() + creator_pos + 12);
+            allocationStack = true;
+            continue;
+        }
+        if (line[0] != '#' && thread_pos != std::string::npos) {
+            stackThread = std::atoi(line.c_str() + thread_pos + 8);
+            // "Address 0x... is located in stack of thread T0 at offset 32 in frame"
+            bool frameStack = line.find("is located in stack of thread") != std::string::npos;
+            allocationStack = frameStack || line.find("freed by") != std::string::npos ||
+                              line.find("allocated by") != std::string::npos;
+            // the first stack of the report is the one of the bad access
+            if (this->crashThread < 0 && !frameStack) {
+                this->crashThread = stackThread;
+                std::cout << "Crash on thread T" << stackThread << std::endl;
+            }
+            continue;
+        }
         // if there is ( in the function name, remove the part between ( and )
         size_t paren_pos_left = line.find('(');
         size_t paren_pos_right = line.find(')');
@@ -329,16 +892,22 @@ void Graph::parseASanOutput(std::string asan_output_file) {
         }
 
         std::vector <std::string> parts = splitBySpace(line);
-        printf("Line: %s parts size: %d\n", line.c_str(), parts.size());
+        printf("Line: %s parts size: %zu\n", line.c_str(), parts.size());
         // Check for a line that contains "in" and has at least 6 parts
-        if (parts.size() >= 4) {
+        if (parts.size() >= 4 && parts[0][0] == '#') {
             FunctionInfo info;
-            info.function_name = parts[3];   // Function name
+            info.function_name = names.intern(parts[3]);   // Function name
 
-            info.file_name = "";
+            info.file_name = names.intern("");
             info.line_number = 0;
+            info.thread = stackThread;
             backtrace.push_back(info);
-            printf("Function: %s, File: %s, Line: %d\n", info.function_name.c_str(), info.file_name.c_str(), info.line_number);
+            // frame #0 of the access stack is where the memory is touched, frame #0 of the
+            // "freed by" and "previously allocated by" stacks is only free or malloc
+            if (parts[0] == "#0" && !allocationStack) {
+                addSink(std::string(info.function_name));
+            }
+            printf("Function: %s, File: %s, Line: %d\n", info.function_name.data(), info.file_name.data(), info.line_number);
         }
     }
 
@@ -349,20 +918,240 @@ void Graph::addBacktrace() {
     std::reverse(backtrace.begin(), backtrace.end());
     for (int i = 0; i < backtrace.size(); i++) {
         if (i + 1 < backtrace.size()) {
-            addCall(backtrace[i].function_name.c_str(), backtrace[i + 1].function_name.c_str());
-            printf("Adding call from %s to %s\n", backtrace[i].function_name.c_str(), backtrace[i + 1].function_name.c_str());
+            // an edge inside one stack belongs to the thread of that stack,
+            // consecutive stacks of two different threads are not linked at all
+            if (backtrace[i].thread >= 0 && backtrace[i + 1].thread >= 0 && backtrace[i].thread != backtrace[i + 1].thread) {
+                continue;
+            }
+            if (backtrace[i].thread >= 0) {
+                addCallOnThread(backtrace[i].function_name.data(), backtrace[i + 1].function_name.data(), backtrace[i].thread);
+            } else {
+                addCall(backtrace[i].function_name.data(), backtrace[i + 1].function_name.data());
+            }
+            this->backtraceCalls[{withoutInterceptor(backtrace[i].function_name),
+                                  withoutInterceptor(backtrace[i + 1].function_name)}]++;
+            printf("Adding call from %s to %s\n", backtrace[i].function_name.data(), backtrace[i + 1].function_name.data());
         }
     }
 }
 
 void Graph::removeInterceptors() {
     std::cout << "Removing interceptors" << std::endl;
+    // an interceptor renamed to a function that is already in the graph is merged into it afterwards
+    std::vector<std::pair<Node*, Node*>> duplicates;
     for (int i = 0; i < this->list.size(); i++) {
         std::cout << "Checking " << this->list[i]->get_name() << std::endl;
         if (this->list[i]->get_name().find("__interceptor_") != std::string::npos) {
             // remove "__interceptor_" from the function name
-            this->list[i]->change_name(this->list[i]->get_name().substr(14));
+            auto indexed = this->index.find(this->list[i]->get_name());
+            if (indexed != this->index.end() && indexed->second == this->list[i]) {
+                this->index.erase(indexed);
+            }
+            std::string_view name = this->names.intern(this->list[i]->get_name().substr(14));
+            this->list[i]->change_name(name);
+            auto inserted = this->index.emplace(name, this->list[i]);
+            if (!inserted.second && inserted.first->second != this->list[i]) {
+                duplicates.push_back({this->list[i], inserted.first->second});
+            }
+        }
+    }
+    std::unordered_set<Node*> removed;
+    for (auto& [from, into] : duplicates) {
+        mergeNode(from, into);
+        removed.insert(from);
+    }
+    dropNodes(removed);
+}
+
+void Graph::mergeNode(Node* from, Node* into) {
+    // move every incoming and outgoing edge of from over to into
+    for (Node* node : this->list) {
+        if (node == from) {
+            continue;
+        }
+        std::vector<ThreadCount> threads = node->get_threads(from);
+        int count = node->remove_next(from);
+        if (count > 0) {
+            node->add_next(into, count);
+            for (const auto& tag : threads) {
+                node->add_thread_calls(into, tag.thread, tag.count);
+            }
+        }
+    }
+    std::vector<Node*> nodes(from->get_next().begin(), from->get_next().end());
+    for (Node* next : nodes) {
+        std::vector<ThreadCount> threads = from->get_threads(next);
+        int count = from->remove_next(next);
+        Node* target = next == from ? into : next;
+        into->add_next(target, count);
+        for (const auto& tag : threads) {
+            into->add_thread_calls(target, tag.thread, tag.count);
+        }
+    }
+}
+
+void Graph::dropNodes(const std::unordered_set<Node*>& removed) {
+    // the nodes stay in the arena, they are only unlinked from the list and the index
+    if (removed.empty()) {
+        return;
+    }
+    std::vector<Node*> kept;
+    for (Node* node : this->list) {
+        if (removed.find(node) == removed.end()) {
+            kept.push_back(node);
+            continue;
+        }
+        auto indexed = this->index.find(node->get_name());
+        if (indexed != this->index.end() && indexed->second == node) {
+            this->index.erase(indexed);
+        }
+    }
+    this->list = kept;
+    this->size = this->list.size();
+    this->clearPathCaches();
+}
+
+void Graph::loadContractionRules(std::string rules_file) {
+    std::ifstream file(rules_file);
+    if (!file.is_open()) {
+        std::cerr << "Error: unable to open file " << rules_file << std::endl;
+        return;
+    }
+
+    // every key that is present replaces the default rule of the same kind
+    nlohmann::json j;
+    file >> j;
+    if (j.contains("prefixes")) {
+        this->contractionRules.prefixes = j["prefixes"].get<std::vector<std::string>>();
+    }
+    if (j.contains("suffixes")) {
+        this->contractionRules.suffixes = j["suffixes"].get<std::vector<std::string>>();
+    }
+    if (j.contains("names")) {
+        this->contractionRules.names = j["names"].get<std::set<std::string>>();
+    }
+    if (j.contains("collapse_pass_through")) {
+        this->contractionRules.collapsePassThrough = j["collapse_pass_through"].get<bool>();
+    }
+    file.close();
+}
+
+bool Graph::matchesContractionRule(std::string_view name) {
+    for (const auto& prefix : this->contractionRules.prefixes) {
+        if (name.substr(0, prefix.size()) == prefix) {
+            return true;
+        }
+    }
+    for (const auto& suffix : this->contractionRules.suffixes) {
+        if (name.size() >= suffix.size() && name.substr(name.size() - suffix.size()) == suffix) {
+            return true;
+        }
+    }
+    return this->contractionRules.names.find(std::string(name)) != this->contractionRules.names.end();
+}
+
+void Graph::foldNode(Node* node, std::unordered_map<Node*, Path>& preds) {
+    // every predecessor calls the successors directly, an edge keeps the smaller of the two counts
+    std::vector<Node*> nodes(node->get_next().begin(), node->get_next().end());
+    std::vector<int> counts(node->get_next_call_count().begin(), node->get_next_call_count().end());
+    std::vector<std::vector<ThreadCount>> outThreads;
+    for (Node* next : nodes) {
+        outThreads.push_back(node->get_threads(next));
+    }
+    for (Node* prev : preds[node]) {
+        if (prev == node) {
+            continue;
+        }
+        std::vector<ThreadCount> inThreads = prev->get_threads(node);
+        int inCount = prev->remove_next(node);
+        for (size_t j = 0; j < nodes.size(); j++) {
+            if (nodes[j] == node) {
+                continue;
+            }
+            prev->add_next(nodes[j], std::min(inCount, counts[j]));
+            addFoldedThreads(prev, nodes[j], inThreads, outThreads[j]);
+            Path& nextPreds = preds[nodes[j]];
+            if (std::find(nextPreds.begin(), nextPreds.end(), prev) == nextPreds.end()) {
+                nextPreds.push_back(prev);
+            }
+        }
+        this->contractedNodes[std::string(node->get_name())].insert(std::string(prev->get_name()));
+    }
+    for (Node* next : nodes) {
+        node->remove_next(next);
+        Path& nextPreds = preds[next];
+        nextPreds.erase(std::remove(nextPreds.begin(), nextPreds.end(), node), nextPreds.end());
+    }
+    this->contractedNodes[std::string(node->get_name())];
+    preds.erase(node);
+}
+
+void Graph::addFoldedThreads(Node* prev, Node* next, const std::vector<ThreadCount>& inThreads,
+                             const std::vector<ThreadCount>& outThreads) {
+    // the folded edge exists on the threads that made both calls, an untagged edge stands for every thread
+    if (inThreads.empty() || outThreads.empty()) {
+        for (const auto& tag : inThreads.empty() ? outThreads : inThreads) {
+            prev->add_thread_calls(next, tag.thread, tag.count);
         }
+        return;
+    }
+    for (const auto& in : inThreads) {
+        for (const auto& out : outThreads) {
+            if (in.thread == out.thread) {
+                prev->add_thread_calls(next, in.thread, std::min(in.count, out.count));
+            }
+        }
+    }
+}
+
+void Graph::contractGraph() {
+    // main and the sinks are the ends of every chain and are never contracted
+    auto isProtected = [&](Node* node) {
+        return node->get_name() == "main" || this->sinks.find(std::string(node->get_name())) != this->sinks.end();
+    };
+    int sizeBefore = this->list.size();
+    std::unordered_map<Node*, Path> preds = reverseGraph();
+    std::unordered_set<Node*> removed;
+
+    for (Node* node : this->list) {
+        if (!isProtected(node) && matchesContractionRule(node->get_name())) {
+            foldNode(node, preds);
+            removed.insert(node);
+        }
+    }
+
+    // wrappers that only forward one caller to one callee, repeated so whole chains collapse
+    bool changed = this->contractionRules.collapsePassThrough;
+    while (changed) {
+        changed = false;
+        for (Node* node : this->list) {
+            if (removed.find(node) != removed.end() || isProtected(node)) {
+                continue;
+            }
+            const Path& nodePreds = preds[node];
+            const auto& nodes = node->get_next();
+            if (nodePreds.size() != 1 || nodes.size() != 1) {
+                continue;
+            }
+            Node* prev = nodePreds[0];
+            Node* next = nodes[0];
+            if (prev == node || next == node || prev == next) {
+                continue;
+            }
+            foldNode(node, preds);
+            removed.insert(node);
+            changed = true;
+        }
+    }
+
+    dropNodes(removed);
+    std::cout << "Contracted graph from " << sizeBefore << " to " << this->list.size() << " nodes" << std::endl;
+    for (const auto& [name, into] : this->contractedNodes) {
+        std::cout << "Contracted " << name << " into";
+        for (const auto& prev : into) {
+            std::cout << " " << prev;
+        }
+        std::cout << std::endl;
     }
 
 }
@@ -6,7 +6,12 @@
 #define DYNAMORIO_GRAPH_H
 
 #include "node.h"
+#include "namePool.h"
+#include "graphFile.h"
 #include "staticAnalyzer.h"
+#include "functionCache.h"
+#include "sourceStore.h"
+#include "projectIndex.h"
 #include <algorithm>  // Required for std::find
 #include <vector>
 #include <string>
@@ -22,22 +27,56 @@
 #include <sstream>
 #include <set>
 #include <map>
+#include <unordered_set>
+#include <memory>
+#include <tuple>
 // include json
 #include <nlohmann/json.hpp>
 
 using namespace std;
+// names are interned in the NamePool of the Graph that owns the backtrace
 struct FunctionInfo {
-    std::string function_name;
-    std::string file_name;
+    std::string_view function_name;
+    std::string_view file_name;
     int line_number;
+    int thread;     // ASan thread T<n> of the stack the frame belongs to, -1 when unknown
 };
 
 
 typedef std::vector<Node*> Path;
+// which nodes contractGraph folds into their neighbours
+struct ContractionRules {
+    std::vector<std::string> prefixes;      // e.g. ASan runtime wrappers
+    std::vector<std::string> suffixes;      // e.g. PLT stubs
+    std::set<std::string> names;            // e.g. crt helpers such as frame_dummy
+    bool collapsePassThrough;               // single-predecessor/single-successor nodes
+};
+// the last analysis of a function in one direction, reached from one caller, by the taint worklist
+struct FunctionSummary {
+    TaintSet previousParams;                              // tainted parameters of the caller it was reached from
+    FunctionTaint output;                                 // taint of the function after the analysis
+    std::vector<std::pair<std::string, bool>> callees;    // functions the analysis asked to visit
+};
+// {function, isForward, previous function}
+typedef std::tuple<std::string, bool, std::string> SummaryKey;
+// a call chain from the entry to one of the sinks, labelled with that sink
+struct CallChain {
+    std::string sink;
+    Path path;
+};
 class Graph {
 private:
+    // graph files loaded with loadBinary, names of their nodes point into the mappings
+    std::vector<std::unique_ptr<GraphFile>> mappedFiles;
+    // nodes, their adjacency and all names live in the arena and are released with the graph
+    std::pmr::monotonic_buffer_resource arena;
+    NamePool names;
     std::vector<Node*> list;
+    std::unordered_map<std::string_view, Node*> index;
     std::vector<FunctionInfo> backtrace;
+    // calls addBacktrace put into the graph per (caller, callee), named as after removeInterceptors,
+    // so what the run itself observed can be told apart from what the ASan report injected
+    std::map<std::pair<std::string, std::string>, int> backtraceCalls;
     std::map<std::string, std::vector<std::string>> definitions;
     struct PollutionInfo {
         std::set<std::string> var;
@@ -45,27 +84,100 @@ private:
     };
 
     std::map<std::string, PollutionInfo> pollutionInfos;
+    // sink functions to search backward from, taken from the ASan report or a config file
+    std::set<std::string> sinks;
+    // thread the ASan report says the bad access happened on, -1 when unknown
+    int crashThread;
+    // reversed subgraph induced by the nodes between an entry and a sink, cached per (entry, sink, thread)
+    std::map<std::tuple<Node*, Node*, int>, std::unordered_map<Node*, Path>> prunedGraphs;
+    // reversed graph per thread view (-1 is the whole graph), dropped together with prunedGraphs
+    std::map<int, std::unordered_map<Node*, Path>> reversedGraphs;
+    // nodes reachable from an entry per (entry, thread), shared by the pruned graphs of all sinks
+    std::map<std::pair<Node*, int>, std::unordered_set<Node*>> entryReachable;
+    // nodes reachable from any node a chain can start at (main or a node without callers) per thread,
+    // a backward search never leaves this set, so predecessors only reached through cycles are skipped for every sink
+    std::map<int, std::unordered_set<Node*>> rootReachable;
+    ContractionRules contractionRules;
+    // contracted node -> the predecessors its calls were folded into, for reporting
+    std::map<std::string, std::set<std::string>> contractedNodes;
+    // function name -> {file, start line, end line}, an empty file when it could not be located
+    std::map<std::string, std::tuple<std::string, int, int>> functionLocations;
+    // parsed elements of every function visited so far, keyed by its location
+    std::map<std::tuple<std::string, int, int>, std::vector<CodeElement>> functionElementCache;
+    int functionCacheLookups;
+    // parsed functions persisted across runs, only used once a directory is set
+    std::unique_ptr<FunctionCache> functionCache;
+    // summaries of the current taint map, a function is analyzed again only when its input taint changed
+    std::map<SummaryKey, FunctionSummary> functionSummaries;
+    int summaryRuns;
+    int summarySkips;
+    // functions parsed ahead of time by indexProject, looked up at the location the binary gives instead of parsing
+    std::unique_ptr<ProjectIndex> projectIndex;
+    int projectIndexHits;
+    // taint results of the previous run, only what the changed pollution info or definitions reach is analyzed again
+    std::string taintStateFile;
+    // source files read once and again only after they change, function bodies are read as views into them;
+    // every file a function was taken from is stamped here, also when the elements came from a cache
+    SourceStore sources;
     int size;
+    Node* createNode(std::string_view name);
+    void clearPathCaches();
+    void clearFunctionSummaries();
+    void refreshSources(StaticAnalyzer& analyzer);
+    const std::unordered_map<Node*, Path>& cachedReverseGraph(int thread);
+    const std::unordered_set<Node*>& cachedEntryReachable(Node* entry, int thread);
+    const std::unordered_set<Node*>& cachedRootReachable(int thread);
+    bool matchesContractionRule(std::string_view name);
+    void foldNode(Node* node, std::unordered_map<Node*, Path>& preds);
+    void addFoldedThreads(Node* prev, Node* next, const std::vector<ThreadCount>& inThreads,
+                          const std::vector<ThreadCount>& outThreads);
+    void mergeNode(Node* from, Node* into);
+    void dropNodes(const std::unordered_set<Node*>& removed);
 public:
     Graph();
     ~Graph();
     void addCall(const char* caller, const char* callee);
+    void addCall(const char* caller, const char* callee, int count);
+    void addCallOnThread(const char* caller, const char* callee, uint32_t thread);
     void printGraph();
-    std::unordered_map<Node*, Path> reverseGraph();
-    void dfs(Node* node, Path& path, std::vector<Path>& allPaths, const std::unordered_map<Node*, Path>& reversed, std::vector<Node*>& visited );
-    std::vector<Path> findAllCallChains(Node* target);
+    bool saveBinary(std::string graph_file);
+    bool loadBinary(std::string graph_file);
+    bool loadText(std::string graph_text_file);
+    std::unordered_map<Node*, Path> reverseGraph(int thread = -1);
+    std::unordered_set<Node*> forwardReachable(const std::vector<Node*>& entries, int thread = -1);
+    const std::unordered_map<Node*, Path>& prunedGraph(Node* entry, Node* sink, const std::unordered_map<Node*, Path>& reversed, int thread = -1);
+    void dfs(Node* node, Path& path, std::vector<Path>& allPaths, const std::unordered_map<Node*, Path>& reversed, const std::unordered_set<Node*>& reachable);
+    std::vector<CallChain> findAllCallChains(const std::vector<Node*>& targets, int thread = -1);
     Node* findNode(const char* name);
     void Traversal(const char* binary_name);
     void visitPath(Path path, StaticAnalyzer& staticAnalyzer,const char *binary_name, TaintMap& taintMap,bool isForward);
-    std::vector<CodeElement> awkElementExtraction(std::string file_name, StaticAnalyzer& analyzer, int start_line_number, int end_column_number);
+    void visitFunctionStack(std::stack<std::pair<std::string, bool>>& functionStack, StaticAnalyzer& analyzer,
+                            const char *binary_name, TaintMap& taintMap, std::string previousFunction);
+    const std::vector<CodeElement>* functionElements(const char *binary_name, StaticAnalyzer& analyzer, std::string function_name);
+    TaintMap taintFunction(const char *binary_name, StaticAnalyzer& analyzer, std::string function_name, const std::set<std::string>& params);
+    TaintMap pollutionTaintMap(StaticAnalyzer& analyzer);
+    void setFunctionCacheDir(std::string function_cache_dir);
+    bool loadProjectIndex(std::string project_index_file);
+    void setTaintStateFile(std::string taint_state_file);
+    std::vector<CodeElement> sourceElementExtraction(std::string file_name, StaticAnalyzer& analyzer, int start_line_number, int end_column_number);
     void addNode(const char* name);
     int getSize();
+    const std::vector<Node*>& getNodes();
+    bool hasBacktrace();
+    int getBacktraceCalls(std::string_view caller, std::string_view callee);
+    int getCrashThread();
     void parseASanOutput(std::string asan_output_file);
     void loadDefineJson(std::string define_json_file);
-    void loadPollutionInfo(std::string pollution_info_file);
+    // replace drops the info loaded before, but only once the new file parsed
+    bool loadPollutionInfo(std::string pollution_info_file, bool replace = false);
+    void loadSinks(std::string sink_file);
+    void addSink(std::string sink);
+    void addBacktraceSink();
     std::vector<std::string> splitBySpace(const std::string &line);
     void addBacktrace();
     void removeInterceptors();
+    void loadContractionRules(std::string rules_file);
+    void contractGraph();
 
 };
 
@@ -0,0 +1,89 @@
+//
+// Created by mxu49 on 2026/10/18.
+// g++ -std=c++17 -o graphConvert graphConvert.cpp graph.cpp graphFile.cpp graphStore.cpp elfFile.cpp node.cpp namePool.cpp staticAnalyzer.cpp srcMLParser.cpp elementStream.cpp codePreprocessor.cpp taintSet.cpp functionCache.cpp mappedFile.cpp projectIndex.cpp functionIndex.cpp sourceStore.cpp `xml2-config --cflags --libs` -lsrcml -ldwarf
+//
+// Converts between the printGraph text output and the binary graph file,
+// and extracts a view of a graph store into a graph file.
+//
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include "graph.h"
+#include "graphFile.h"
+#include "graphStore.h"
+#include "elfFile.h"
+
+static int printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " to-binary <graph.txt> <graph.bin>" << std::endl;
+    std::cerr << "       " << program << " to-text <graph.bin>" << std::endl;
+    std::cerr << "       " << program << " from-store <store_dir> <binary|build-id> <union|intersection|crash-only> <graph.bin>" << std::endl;
+    return 1;
+}
+
+// prints the mapped file in the same layout as Graph::printGraph, without building a Graph
+static int toText(const char* binary_file) {
+    auto start = std::chrono::steady_clock::now();
+    GraphFile graph;
+    if (!graph.open(binary_file)) {
+        return 1;
+    }
+    auto loaded = std::chrono::steady_clock::now();
+    std::cerr << "Mapped " << graph.nodeCount() << " nodes and " << graph.edgeCount() << " edges in "
+              << std::chrono::duration<double, std::milli>(loaded - start).count() << " ms" << std::endl;
+
+    for (uint32_t i = 0; i < graph.nodeCount(); i++) {
+        if (graph.edgeBegin(i) == graph.edgeEnd(i)) {
+            continue;
+        }
+        std::cout << "Node " << graph.nodeName(i) << std::endl;
+        for (uint32_t e = graph.edgeBegin(i); e < graph.edgeEnd(i); e++) {
+            std::cout << graph.nodeName(graph.edgeTarget(e)) << " " << graph.edgeCallCount(e) << std::endl;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+static int toBinary(const char* text_file, const char* binary_file) {
+    Graph graph;
+    if (!graph.loadText(text_file)) {
+        return 1;
+    }
+    return graph.saveBinary(binary_file) ? 0 : 1;
+}
+
+static int fromStore(const char* store_dir, const char* binary, const std::string& view_name, const char* binary_file) {
+    StoreView view;
+    if (view_name == "union") {
+        view = STORE_UNION;
+    } else if (view_name == "intersection") {
+        view = STORE_INTERSECTION;
+    } else if (view_name == "crash-only") {
+        view = STORE_CRASH_ONLY;
+    } else {
+        std::cerr << "Unknown view " << view_name << std::endl;
+        return 1;
+    }
+    // the store is keyed by build-id, which can be given directly or read from the binary
+    std::string build_id = std::filesystem::exists(binary) ? readBuildId(binary) : binary;
+    GraphStore store(store_dir, build_id);
+    if (!store.open()) {
+        return 1;
+    }
+    Graph graph;
+    store.buildGraph(graph, view);
+    return graph.saveBinary(binary_file) ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && std::string(argv[1]) == "to-binary") {
+        return toBinary(argv[2], argv[3]);
+    }
+    if (argc == 3 && std::string(argv[1]) == "to-text") {
+        return toText(argv[2]);
+    }
+    if (argc == 6 && std::string(argv[1]) == "from-store") {
+        return fromStore(argv[2], argv[3], argv[4], argv[5]);
+    }
+    return printUsage(argv[0]);
+}
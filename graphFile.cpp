@@ -0,0 +1,239 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "graphFile.h"
+#include <cstring>
+#include <iostream>
+
+GraphFile::GraphFile() {
+    this->header = nullptr;
+}
+
+GraphFile::~GraphFile() {
+    close();
+}
+
+bool GraphFile::open(const std::string& path) {
+    close();
+    if (!this->file.open(path, sizeof(GraphFileHeader))) {
+        std::cerr << "Error: unable to map graph file " << path << std::endl;
+        return false;
+    }
+    this->header = (const GraphFileHeader*)this->file.data();
+
+    const GraphFileHeader* h = this->header;
+    if (memcmp(h->magic, GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC)) != 0) {
+        std::cerr << "Error: " << path << " is not a graph file" << std::endl;
+        close();
+        return false;
+    }
+    if (h->version != GRAPH_FILE_VERSION) {
+        std::cerr << "Error: " << path << " has graph file version " << h->version
+                  << ", expected " << GRAPH_FILE_VERSION << std::endl;
+        close();
+        return false;
+    }
+    // every section has to lie inside the file before anything is read from it
+    uint64_t nodes = h->nodeCount, edges = h->edgeCount;
+    if (!this->file.sectionFits(h->nameOffsetsOffset, nodes, 4) ||
+        !this->file.sectionFits(h->callCountsOffset, nodes, 4) ||
+        !this->file.sectionFits(h->rowOffsetsOffset, nodes + 1, 4) ||
+        !this->file.sectionFits(h->edgeTargetsOffset, edges, 4) ||
+        !this->file.sectionFits(h->edgeCountsOffset, edges, 4) ||
+        !this->file.sectionFits(h->edgeThreadsOffset, edges + 1, 4) ||
+        !this->file.sectionFits(h->threadTagsOffset, h->threadTagCount, sizeof(GraphFileThread)) ||
+        !this->file.sectionFits(h->backtraceOffset, h->backtraceCount, sizeof(GraphFileFrame)) ||
+        !this->file.sectionFits(h->stringTableOffset, h->stringTableSize, 1)) {
+        std::cerr << "Error: " << path << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+    // the accessors index the sections without checks, so a corrupt file is rejected here as a whole
+    if (!consistent()) {
+        std::cerr << "Error: " << path << " is corrupt" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool GraphFile::consistent() {
+    const GraphFileHeader* h = this->header;
+    // the table has to end in a terminator, then every offset inside it names a terminated string
+    uint64_t strings = h->stringTableSize;
+    if (strings != 0 && this->file.data()[h->stringTableOffset + strings - 1] != '\0') {
+        return false;
+    }
+    const uint32_t* names = section(h->nameOffsetsOffset);
+    const uint32_t* rows = section(h->rowOffsetsOffset);
+    for (uint32_t i = 0; i < h->nodeCount; i++) {
+        if (names[i] >= strings || rows[i] > rows[i + 1]) {
+            return false;
+        }
+    }
+    if (rows[0] != 0 || rows[h->nodeCount] > h->edgeCount) {
+        return false;
+    }
+    const uint32_t* targets = section(h->edgeTargetsOffset);
+    const uint32_t* threads = section(h->edgeThreadsOffset);
+    for (uint32_t e = 0; e < h->edgeCount; e++) {
+        if (targets[e] >= h->nodeCount || threads[e] > threads[e + 1]) {
+            return false;
+        }
+    }
+    if (threads[0] != 0 || threads[h->edgeCount] > h->threadTagCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < h->backtraceCount; i++) {
+        if (frame(i).functionName >= strings || frame(i).fileName >= strings) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void GraphFile::close() {
+    this->file.close();
+    this->header = nullptr;
+}
+
+bool GraphFile::isOpen() {
+    return this->file.isOpen();
+}
+
+const uint32_t* GraphFile::section(uint64_t offset) {
+    return (const uint32_t*)(this->file.data() + offset);
+}
+
+uint32_t GraphFile::nodeCount() {
+    return this->header->nodeCount;
+}
+
+uint32_t GraphFile::edgeCount() {
+    return this->header->edgeCount;
+}
+
+uint32_t GraphFile::backtraceCount() {
+    return this->header->backtraceCount;
+}
+
+int32_t GraphFile::crashThread() {
+    return this->header->crashThread;
+}
+
+std::string_view GraphFile::string(uint32_t offset) {
+    return std::string_view(this->file.data() + this->header->stringTableOffset + offset);
+}
+
+std::string_view GraphFile::nodeName(uint32_t node) {
+    return string(section(this->header->nameOffsetsOffset)[node]);
+}
+
+uint32_t GraphFile::callCount(uint32_t node) {
+    return section(this->header->callCountsOffset)[node];
+}
+
+uint32_t GraphFile::edgeBegin(uint32_t node) {
+    return section(this->header->rowOffsetsOffset)[node];
+}
+
+uint32_t GraphFile::edgeEnd(uint32_t node) {
+    return section(this->header->rowOffsetsOffset)[node + 1];
+}
+
+uint32_t GraphFile::edgeTarget(uint32_t edge) {
+    return section(this->header->edgeTargetsOffset)[edge];
+}
+
+uint32_t GraphFile::edgeCallCount(uint32_t edge) {
+    return section(this->header->edgeCountsOffset)[edge];
+}
+
+uint32_t GraphFile::edgeThreadBegin(uint32_t edge) {
+    return section(this->header->edgeThreadsOffset)[edge];
+}
+
+uint32_t GraphFile::edgeThreadEnd(uint32_t edge) {
+    return section(this->header->edgeThreadsOffset)[edge + 1];
+}
+
+const GraphFileThread& GraphFile::threadTag(uint32_t tag) {
+    return ((const GraphFileThread*)(this->file.data() + this->header->threadTagsOffset))[tag];
+}
+
+const GraphFileFrame& GraphFile::frame(uint32_t index) {
+    return ((const GraphFileFrame*)(this->file.data() + this->header->backtraceOffset))[index];
+}
+
+uint32_t GraphFileWriter::addString(std::string_view value) {
+    auto it = this->stringOffsets.find(std::string(value));
+    if (it != this->stringOffsets.end()) {
+        return it->second;
+    }
+    uint32_t offset = this->strings.size();
+    this->strings.append(value.data(), value.size());
+    this->strings.push_back('\0');
+    this->stringOffsets.emplace(std::string(value), offset);
+    return offset;
+}
+
+bool GraphFileWriter::write(const std::string& path) {
+    GraphFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC));
+    header.version = GRAPH_FILE_VERSION;
+    header.nodeCount = this->names.size();
+    header.edgeCount = this->edgeTargets.size();
+    header.backtraceCount = this->frames.size();
+    header.threadTagCount = this->threadTags.size();
+    header.crashThread = this->crashThread;
+    // a graph without thread information still gets one offset per edge, all of them 0
+    if (this->edgeThreads.size() != this->edgeTargets.size() + 1) {
+        this->edgeThreads.assign(this->edgeTargets.size() + 1, 0);
+        this->threadTags.clear();
+        header.threadTagCount = 0;
+    }
+
+    uint64_t offset = alignSection(sizeof(header));
+    header.nameOffsetsOffset = offset;
+    offset = alignSection(offset + this->names.size() * 4);
+    header.callCountsOffset = offset;
+    offset = alignSection(offset + this->callCounts.size() * 4);
+    header.rowOffsetsOffset = offset;
+    offset = alignSection(offset + this->rowOffsets.size() * 4);
+    header.edgeTargetsOffset = offset;
+    offset = alignSection(offset + this->edgeTargets.size() * 4);
+    header.edgeCountsOffset = offset;
+    offset = alignSection(offset + this->edgeCounts.size() * 4);
+    header.edgeThreadsOffset = offset;
+    offset = alignSection(offset + this->edgeThreads.size() * 4);
+    header.threadTagsOffset = offset;
+    offset = alignSection(offset + this->threadTags.size() * sizeof(GraphFileThread));
+    header.backtraceOffset = offset;
+    offset = alignSection(offset + this->frames.size() * sizeof(GraphFileFrame));
+    header.stringTableOffset = offset;
+    header.stringTableSize = this->strings.size();
+
+    // the graph being replaced may be mapped by a reader, so it is swapped out rather than truncated
+    AtomicFileWriter file;
+    if (!file.open(path)) {
+        std::cerr << "Error: unable to open file " << file.temporaryPath() << std::endl;
+        return false;
+    }
+    file.put(0, &header, sizeof(header));
+    file.put(header.nameOffsetsOffset, this->names.data(), this->names.size() * 4);
+    file.put(header.callCountsOffset, this->callCounts.data(), this->callCounts.size() * 4);
+    file.put(header.rowOffsetsOffset, this->rowOffsets.data(), this->rowOffsets.size() * 4);
+    file.put(header.edgeTargetsOffset, this->edgeTargets.data(), this->edgeTargets.size() * 4);
+    file.put(header.edgeCountsOffset, this->edgeCounts.data(), this->edgeCounts.size() * 4);
+    file.put(header.edgeThreadsOffset, this->edgeThreads.data(), this->edgeThreads.size() * 4);
+    file.put(header.threadTagsOffset, this->threadTags.data(), this->threadTags.size() * sizeof(GraphFileThread));
+    file.put(header.backtraceOffset, this->frames.data(), this->frames.size() * sizeof(GraphFileFrame));
+    file.put(header.stringTableOffset, this->strings.data(), this->strings.size());
+    if (!file.commit()) {
+        std::cerr << "Error: unable to write graph file " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_GRAPHFILE_H
+#define DYNAMORIO_GRAPHFILE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "mappedFile.h"
+
+// Binary call graph file, laid out so it can be used straight from mmap:
+//   header | name offsets | call counts | CSR row offsets | edge targets | edge counts
+//          | edge thread offsets | thread tags | backtrace | string table
+// All integers are little-endian, every section starts 8-byte aligned,
+// strings are null-terminated and referenced by their offset in the string table.
+#define GRAPH_FILE_MAGIC "PFGRAPH"
+#define GRAPH_FILE_VERSION 2
+
+struct GraphFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t edgeCount;
+    uint32_t backtraceCount;
+    uint32_t threadTagCount;
+    int32_t crashThread;           // -1 when the report named no thread
+    uint64_t nameOffsetsOffset;    // uint32_t[nodeCount], offsets into the string table
+    uint64_t callCountsOffset;     // uint32_t[nodeCount]
+    uint64_t rowOffsetsOffset;     // uint32_t[nodeCount + 1], edges of node i are [row[i], row[i + 1])
+    uint64_t edgeTargetsOffset;    // uint32_t[edgeCount], callee node index
+    uint64_t edgeCountsOffset;     // uint32_t[edgeCount], number of calls along the edge
+    uint64_t edgeThreadsOffset;    // uint32_t[edgeCount + 1], tags of edge e are [threads[e], threads[e + 1])
+    uint64_t threadTagsOffset;     // GraphFileThread[threadTagCount]
+    uint64_t backtraceOffset;      // GraphFileFrame[backtraceCount]
+    uint64_t stringTableOffset;
+    uint64_t stringTableSize;
+};
+
+struct GraphFileFrame {
+    uint32_t functionName;
+    uint32_t fileName;
+    int32_t lineNumber;
+    int32_t thread;                // -1 when unknown
+};
+
+struct GraphFileThread {
+    uint32_t thread;
+    uint32_t count;
+};
+
+// Read-only view of a graph file mapped into memory, nothing is parsed or copied on open.
+class GraphFile {
+private:
+    MappedFile file;
+    const GraphFileHeader* header;
+    const uint32_t* section(uint64_t offset);
+    bool consistent();
+public:
+    GraphFile();
+    ~GraphFile();
+    GraphFile(const GraphFile&) = delete;
+    GraphFile& operator=(const GraphFile&) = delete;
+    bool open(const std::string& path);
+    void close();
+    bool isOpen();
+    uint32_t nodeCount();
+    uint32_t edgeCount();
+    uint32_t backtraceCount();
+    int32_t crashThread();
+    std::string_view string(uint32_t offset);
+    std::string_view nodeName(uint32_t node);
+    uint32_t callCount(uint32_t node);
+    uint32_t edgeBegin(uint32_t node);
+    uint32_t edgeEnd(uint32_t node);
+    uint32_t edgeTarget(uint32_t edge);
+    uint32_t edgeCallCount(uint32_t edge);
+    uint32_t edgeThreadBegin(uint32_t edge);
+    uint32_t edgeThreadEnd(uint32_t edge);
+    const GraphFileThread& threadTag(uint32_t tag);
+    const GraphFileFrame& frame(uint32_t index);
+};
+
+// Collects the sections of a graph file in memory and writes them out in one go, under a temporary
+// name renamed over the destination, so a graph being read or mapped is never overwritten in place.
+class GraphFileWriter {
+private:
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> stringOffsets;
+public:
+    std::vector<uint32_t> names;
+    std::vector<uint32_t> callCounts;
+    std::vector<uint32_t> rowOffsets;
+    std::vector<uint32_t> edgeTargets;
+    std::vector<uint32_t> edgeCounts;
+    std::vector<uint32_t> edgeThreads;
+    std::vector<GraphFileThread> threadTags;
+    std::vector<GraphFileFrame> frames;
+    int32_t crashThread = -1;
+    uint32_t addString(std::string_view value);
+    bool write(const std::string& path);
+};
+
+
+#endif //DYNAMORIO_GRAPHFILE_H
@@ -0,0 +1,359 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "graphStore.h"
+#include "graph.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+GraphStore::GraphStore(std::string directory, std::string build_id) {
+    this->path = directory + "/" + build_id + ".pfstore";
+    this->logEnd = 0;
+    // the store is merged from the DynamoRIO exit handler, nothing here may throw
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cerr << "Error: unable to create directory " << directory << ": " << error.message() << std::endl;
+    }
+}
+
+template <typename T>
+static bool readValue(std::ifstream& file, T& value) {
+    file.read((char*)&value, sizeof(value));
+    return file.gcount() == sizeof(value);
+}
+
+static bool readString(std::ifstream& file, std::string& value, uint64_t fileSize) {
+    uint32_t length = 0;
+    if (!readValue(file, length) || (uint64_t)file.tellg() + length > fileSize) {
+        return false;
+    }
+    value.resize(length);
+    file.read(&value[0], length);
+    return file.gcount() == length;
+}
+
+template <typename T>
+static void appendValue(std::string& buffer, T value) {
+    buffer.append((const char*)&value, sizeof(value));
+}
+
+static void appendString(std::string& buffer, const std::string& value) {
+    appendValue(buffer, (uint32_t)value.size());
+    buffer.append(value);
+}
+
+// a name whose id in the file was taken over by another name
+static const uint32_t NO_FILE_ID = UINT32_MAX;
+
+static bool lockStore(int fd) {
+    while (flock(fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GraphStore::open() {
+    int fd = ::open(this->path.c_str(), O_RDWR);
+    if (fd == -1) {
+        if (errno == ENOENT) {
+            // new store, the header is written with the first merge
+            return true;
+        }
+        std::cerr << "Error: unable to open file " << this->path << std::endl;
+        return false;
+    }
+    // replaying may cut off a record a crashed merge left behind, so no merge may be appending meanwhile
+    if (!lockStore(fd)) {
+        std::cerr << "Error: unable to lock " << this->path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    bool loaded = readLog();
+    ::close(fd);
+    if (loaded) {
+        std::cout << "Graph store " << this->path << ": " << this->runs.size() << " runs, "
+                  << this->edges.size() << " edges" << std::endl;
+    }
+    return loaded;
+}
+
+bool GraphStore::readLog() {
+    std::ifstream file(this->path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Error: unable to open file " << this->path << std::endl;
+        return false;
+    }
+    uint64_t fileSize = file.tellg();
+    file.seekg(0);
+    if (this->logEnd == 0) {
+        if (fileSize == 0) {
+            // created by a merge that did not get to write anything yet
+            return true;
+        }
+        char magic[8];
+        uint32_t version = 0;
+        file.read(magic, sizeof(magic));
+        if (file.gcount() != sizeof(magic) || memcmp(magic, GRAPH_STORE_MAGIC, sizeof(GRAPH_STORE_MAGIC)) != 0 ||
+            !readValue(file, version)) {
+            std::cerr << "Error: " << this->path << " is not a graph store" << std::endl;
+            return false;
+        }
+        if (version != GRAPH_STORE_VERSION) {
+            std::cerr << "Error: " << this->path << " has graph store version " << version
+                      << ", expected " << GRAPH_STORE_VERSION << std::endl;
+            return false;
+        }
+        this->logEnd = file.tellg();
+    }
+
+    // replay what was appended since the last read, only a record that runs past
+    // the end of the file (an interrupted merge) is cut off
+    file.seekg(this->logEnd);
+    char tag;
+    while (file.get(tag)) {
+        bool complete = false;
+        if (tag == 'N') {
+            uint32_t id;
+            std::string name;
+            complete = readValue(file, id) && readString(file, name, fileSize);
+            if (complete) {
+                if (id > this->fileNameIds.size()) {
+                    std::cerr << "Error: " << this->path << " skips name id " << this->fileNameIds.size() << std::endl;
+                    return false;
+                }
+                uint32_t nameId = internName(name);
+                if (id == this->fileNameIds.size()) {
+                    this->fileNameIds.push_back(nameId);
+                } else {
+                    // the name that had this id loses it, a later merge writes that name again
+                    uint32_t previous = this->fileNameIds[id];
+                    if (this->nameFileIds[previous] == id) {
+                        this->nameFileIds[previous] = NO_FILE_ID;
+                    }
+                    this->fileNameIds[id] = nameId;
+                }
+                this->nameFileIds[nameId] = id;
+            }
+        } else if (tag == 'R') {
+            uint32_t run, edgeCount;
+            uint8_t crashing;
+            std::string label;
+            std::vector<uint32_t> record;
+            if (readValue(file, run) && readValue(file, crashing) && readString(file, label, fileSize) &&
+                readValue(file, edgeCount) && (uint64_t)file.tellg() + (uint64_t)edgeCount * 12 <= fileSize) {
+                record.resize((size_t)edgeCount * 3);
+                file.read((char*)record.data(), record.size() * sizeof(uint32_t));
+                complete = file.gcount() == (std::streamsize)(record.size() * sizeof(uint32_t));
+            }
+            if (complete) {
+                // run numbers are assigned by replay order, a number reused by an unlocked writer is harmless
+                bool known = true;
+                for (size_t i = 0; i < record.size(); i += 3) {
+                    if (record[i] >= this->fileNameIds.size() || record[i + 1] >= this->fileNameIds.size()) {
+                        known = false;
+                    }
+                }
+                if (known) {
+                    uint32_t storeRun = this->runs.size();
+                    this->runs.push_back({label, crashing != 0});
+                    for (size_t i = 0; i < record.size(); i += 3) {
+                        addEdge(this->fileNameIds[record[i]], this->fileNameIds[record[i + 1]], record[i + 2], storeRun);
+                    }
+                } else {
+                    std::cerr << "Warning: skipping run " << label << " in " << this->path
+                              << ", it refers to names the store does not have" << std::endl;
+                }
+            }
+        } else {
+            std::cerr << "Error: unknown record at offset " << this->logEnd << " of " << this->path << std::endl;
+            return false;
+        }
+        if (!complete) {
+            std::cerr << "Warning: dropping incomplete record at the end of " << this->path << std::endl;
+            file.close();
+            std::error_code error;
+            std::filesystem::resize_file(this->path, this->logEnd, error);
+            if (error) {
+                std::cerr << "Error: unable to truncate " << this->path << ": " << error.message() << std::endl;
+                return false;
+            }
+            return true;
+        }
+        this->logEnd = file.tellg();
+    }
+    return true;
+}
+
+uint32_t GraphStore::internName(const std::string& name) {
+    auto it = this->nameIds.find(name);
+    if (it != this->nameIds.end()) {
+        return it->second;
+    }
+    uint32_t id = this->names.size();
+    this->nameIds[name] = id;
+    this->names.push_back(name);
+    this->nameFileIds.push_back(NO_FILE_ID);
+    return id;
+}
+
+void GraphStore::addEdge(uint32_t caller, uint32_t callee, uint32_t count, uint32_t run) {
+    StoreEdge& edge = this->edges[std::make_pair(caller, callee)];
+    edge.count += count;
+    if (edge.runs.size() <= run / 64) {
+        edge.runs.resize(run / 64 + 1, 0);
+    }
+    edge.runs[run / 64] |= (uint64_t)1 << (run % 64);
+}
+
+bool GraphStore::hasRun(const StoreEdge& edge, uint32_t run) {
+    return run / 64 < edge.runs.size() && (edge.runs[run / 64] >> (run % 64)) & 1;
+}
+
+bool GraphStore::merge(Graph& graph, bool crashing, std::string label) {
+    int fd = ::open(this->path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd == -1) {
+        std::cerr << "Error: unable to open file " << this->path << std::endl;
+        return false;
+    }
+    if (!lockStore(fd)) {
+        std::cerr << "Error: unable to lock " << this->path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    // runs merged since open() are read first, so the ids assigned below follow theirs
+    if (!readLog()) {
+        ::close(fd);
+        return false;
+    }
+    std::string buffer;
+    if (this->logEnd == 0) {
+        buffer.append(GRAPH_STORE_MAGIC, sizeof(GRAPH_STORE_MAGIC));
+        appendValue(buffer, (uint32_t)GRAPH_STORE_VERSION);
+    }
+
+    // names seen for the first time are appended before the run that uses them,
+    // they only become part of the store once the write went through
+    std::unordered_map<std::string, uint32_t> newIds;
+    std::vector<std::string> newNames;
+    auto nameId = [&](std::string_view name) {
+        std::string key(name);
+        auto it = this->nameIds.find(key);
+        if (it != this->nameIds.end() && this->nameFileIds[it->second] != NO_FILE_ID) {
+            return this->nameFileIds[it->second];
+        }
+        it = newIds.find(key);
+        if (it != newIds.end()) {
+            return it->second;
+        }
+        uint32_t id = this->fileNameIds.size() + newNames.size();
+        newIds[key] = id;
+        newNames.push_back(key);
+        buffer.push_back('N');
+        appendValue(buffer, id);
+        appendString(buffer, key);
+        return id;
+    };
+
+    std::vector<uint32_t> record;
+    for (Node* node : graph.getNodes()) {
+        const auto& nodes = node->get_next();
+        const auto& counts = node->get_next_call_count();
+        for (size_t j = 0; j < nodes.size(); j++) {
+            // calls that only the ASan backtrace put into the graph were never observed in this run
+            int count = counts[j] - graph.getBacktraceCalls(node->get_name(), nodes[j]->get_name());
+            if (count <= 0) {
+                continue;
+            }
+            record.push_back(nameId(node->get_name()));
+            record.push_back(nameId(nodes[j]->get_name()));
+            record.push_back(count);
+        }
+    }
+
+    uint32_t run = this->runs.size();
+    buffer.push_back('R');
+    appendValue(buffer, run);
+    appendValue(buffer, (uint8_t)(crashing ? 1 : 0));
+    appendString(buffer, label);
+    appendValue(buffer, (uint32_t)(record.size() / 3));
+    buffer.append((const char*)record.data(), record.size() * sizeof(uint32_t));
+
+    size_t written = 0;
+    while (written < buffer.size()) {
+        ssize_t count = ::write(fd, buffer.data() + written, buffer.size() - written);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            std::cerr << "Error: unable to write to " << this->path << std::endl;
+            ::close(fd);
+            return false;
+        }
+        written += count;
+    }
+    ::close(fd);
+    this->logEnd += buffer.size();
+
+    for (const auto& name : newNames) {
+        uint32_t nameId = internName(name);
+        this->nameFileIds[nameId] = this->fileNameIds.size();
+        this->fileNameIds.push_back(nameId);
+    }
+    this->runs.push_back({label, crashing});
+    for (size_t i = 0; i < record.size(); i += 3) {
+        addEdge(this->fileNameIds[record[i]], this->fileNameIds[record[i + 1]], record[i + 2], run);
+    }
+    std::cout << "Merged run " << run << " (" << record.size() / 3 << " edges) into " << this->path << std::endl;
+    return true;
+}
+
+void GraphStore::buildGraph(Graph& graph, StoreView view) {
+    for (const auto& [key, edge] : this->edges) {
+        bool keep = false;
+        if (view == STORE_UNION) {
+            keep = true;
+        } else if (view == STORE_INTERSECTION) {
+            keep = true;
+            for (uint32_t run = 0; run < this->runs.size(); run++) {
+                if (!hasRun(edge, run)) {
+                    keep = false;
+                    break;
+                }
+            }
+        } else if (view == STORE_CRASH_ONLY) {
+            bool inCrashingRun = false;
+            bool inOtherRun = false;
+            for (uint32_t run = 0; run < this->runs.size(); run++) {
+                if (hasRun(edge, run)) {
+                    if (this->runs[run].crashing) {
+                        inCrashingRun = true;
+                    } else {
+                        inOtherRun = true;
+                    }
+                }
+            }
+            keep = inCrashingRun && !inOtherRun;
+        }
+        if (keep) {
+            graph.addCall(this->names[key.first].c_str(), this->names[key.second].c_str(), edge.count);
+        }
+    }
+}
+
+int GraphStore::getRunCount() {
+    return this->runs.size();
+}
+
+int GraphStore::getEdgeCount() {
+    return this->edges.size();
+}
@@ -0,0 +1,71 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_GRAPHSTORE_H
+#define DYNAMORIO_GRAPHSTORE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Graph;
+
+// Append-only log of call graphs from many runs (PoCs, fuzzer crashes) of one binary,
+// stored as <directory>/<build-id>.pfstore. The file holds a header followed by records:
+//   'N' id:u32 length:u32 bytes          a function name, ids are assigned in order
+//   'R' run:u32 crashing:u8 length:u32 label edges:u32 (caller:u32 callee:u32 count:u32)*
+// A merge only appends the new names and one run record, nothing already written is rewritten.
+// Merges hold an exclusive flock on the file from reading its tail until their records are appended,
+// so runs merging at the same time (parallel PoCs, fuzzer workers) get consecutive ids.
+#define GRAPH_STORE_MAGIC "PFSTORE"
+#define GRAPH_STORE_VERSION 1
+
+typedef enum {
+    STORE_UNION = 0,           // edges seen in any run
+    STORE_INTERSECTION,        // edges seen in every run
+    STORE_CRASH_ONLY           // edges seen in a crashing run but in no other run
+} StoreView;
+
+struct StoreRun {
+    std::string label;
+    bool crashing;
+};
+
+struct StoreEdge {
+    uint64_t count;
+    std::vector<uint64_t> runs;    // provenance bitmap, bit i is set when run i took the edge
+};
+
+class GraphStore {
+private:
+    std::string path;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> nameIds;
+    // name id in the file -> index into names, stores written before merges were locked can reuse an id,
+    // a run record then refers to the name written last under it
+    std::vector<uint32_t> fileNameIds;
+    // index into names -> an id the file knows that name by
+    std::vector<uint32_t> nameFileIds;
+    std::vector<StoreRun> runs;
+    std::map<std::pair<uint32_t, uint32_t>, StoreEdge> edges;
+    // end of the part of the log already replayed, 0 before the header was read
+    uint64_t logEnd;
+    bool readLog();
+    uint32_t internName(const std::string& name);
+    void addEdge(uint32_t caller, uint32_t callee, uint32_t count, uint32_t run);
+    bool hasRun(const StoreEdge& edge, uint32_t run);
+public:
+    GraphStore(std::string directory, std::string build_id);
+    bool open();
+    // records the calls the run observed, the ones only the ASan backtrace added are left out
+    bool merge(Graph& graph, bool crashing, std::string label);
+    void buildGraph(Graph& graph, StoreView view);
+    int getRunCount();
+    int getEdgeCount();
+};
+
+
+#endif //DYNAMORIO_GRAPHSTORE_H
@@ -0,0 +1,147 @@
+//
+// Created by mxu49 on 2026/10/18.
+// g++ -std=c++17 -O2 -o indexProject indexProject.cpp projectIndex.cpp functionCache.cpp mappedFile.cpp staticAnalyzer.cpp srcMLParser.cpp elementStream.cpp codePreprocessor.cpp taintSet.cpp functionIndex.cpp elfFile.cpp sourceStore.cpp node.cpp `xml2-config --cflags --libs` -lsrcml -ldwarf -lpthread
+//
+// Parses every function of a source tree once and writes them into a project index.
+// Files are shared out to a pool of threads, each with its own analyzer. A function is
+// parsed exactly like an online visit, from its source lines, so the analysis sees the
+// same elements whether it reads the index or parses on demand.
+//
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include "elfFile.h"
+#include "projectIndex.h"
+#include "sourceStore.h"
+#include "staticAnalyzer.h"
+
+static int printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <source_dir> <project_index> [threads]" << std::endl;
+    return 1;
+}
+
+static bool isSourceFile(const std::filesystem::path& path) {
+    static const std::set<std::string> extensions = {".c", ".cc", ".cpp", ".cxx", ".h", ".hh", ".hpp", ".hxx"};
+    return extensions.count(path.extension().string()) != 0;
+}
+
+// line of a srcML position attribute "line:column"
+static int positionLine(xmlNode* node, const char* attribute) {
+    xmlChar* position = xmlGetNsProp(node, BAD_CAST attribute, BAD_CAST "http://www.srcML.org/srcML/position");
+    if (position == NULL) {
+        return 0;
+    }
+    int line = std::atoi((const char*)position);
+    xmlFree(position);
+    return line;
+}
+
+// name and lines of every function definition under the node, including class members
+static void collectFunctions(xmlNode* node, const std::string& file, uint64_t contentHash, std::vector<IndexedFunction>& functions) {
+    for (xmlNode* child = node->children; child; child = child->next) {
+        if (child->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+        if (!xmlStrcmp(child->name, BAD_CAST "function")) {
+            for (xmlNode* name = child->children; name; name = name->next) {
+                if (name->type == XML_ELEMENT_NODE && !xmlStrcmp(name->name, BAD_CAST "name")) {
+                    xmlChar* content = xmlNodeGetContent(name);
+                    IndexedFunction function;
+                    function.name = (const char*)content;
+                    function.file = file;
+                    function.contentHash = contentHash;
+                    function.startLine = positionLine(child, "start");
+                    function.endLine = positionLine(child, "end");
+                    xmlFree(content);
+                    if (function.startLine > 0 && function.endLine >= function.startLine) {
+                        functions.push_back(std::move(function));
+                    }
+                    break;
+                }
+            }
+        }
+        collectFunctions(child, file, contentHash, functions);
+    }
+}
+
+static std::vector<IndexedFunction> indexFile(const std::string& file, StaticAnalyzer& analyzer, SourceStore& sources) {
+    std::vector<IndexedFunction> functions;
+    const SourceFile* source = sources.open(file);
+    if (source == NULL || source->lineCount() == 0) {
+        return functions;
+    }
+    std::string_view text = source->lines(1, source->lineCount());
+    xmlDocPtr doc = analyzer.parseSource(std::string(text));
+    if (doc == NULL) {
+        return functions;
+    }
+    // the same hash the analysis computes from the file to tell whether it was edited since
+    collectFunctions(xmlDocGetRootElement(doc), file, fnv1a(text.data(), text.size()), functions);
+    xmlFreeDoc(doc);
+    for (auto& function : functions) {
+        function.elements = analyzer.extractElements(source->lines(function.startLine, function.endLine));
+    }
+    return functions;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        return printUsage(argv[0]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> files;
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(argv[1], error);
+         it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        if (error) {
+            break;
+        }
+        if (it->is_regular_file() && isSourceFile(it->path())) {
+            files.push_back(std::filesystem::absolute(it->path()).lexically_normal().string());
+        }
+    }
+    if (error) {
+        std::cerr << "Error: unable to read directory " << argv[1] << ": " << error.message() << std::endl;
+        return 1;
+    }
+
+    unsigned threads = argc > 3 ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+    threads = std::max(1u, std::min<unsigned>(threads, files.size()));
+    // libxml2 sets up its globals once, before any thread parses
+    xmlInitParser();
+    std::vector<std::vector<IndexedFunction>> perFile(files.size());
+    std::atomic<size_t> nextFile(0);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            StaticAnalyzer analyzer;
+            SourceStore sources;
+            for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+                perFile[i] = indexFile(files[i], analyzer, sources);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<IndexedFunction> functions;
+    size_t elements = 0;
+    for (auto& indexed : perFile) {
+        for (auto& function : indexed) {
+            elements += function.elements.size();
+            functions.push_back(std::move(function));
+        }
+    }
+    bool written = ProjectIndex::write(argv[2], functions);
+    xmlCleanupParser();
+    if (!written) {
+        return 1;
+    }
+    std::cout << "Indexed " << functions.size() << " functions (" << elements << " elements) of " << files.size()
+              << " files with " << threads << " threads in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,121 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "mappedFile.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint64_t alignSection(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+MappedFile::MappedFile() {
+    this->mapping = nullptr;
+    this->mappingSize = 0;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path, size_t minimumSize) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)minimumSize || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    this->mapping = (const char*)mapped;
+    this->mappingSize = st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (this->mapping != nullptr) {
+        munmap((void*)this->mapping, this->mappingSize);
+    }
+    this->mapping = nullptr;
+    this->mappingSize = 0;
+}
+
+bool MappedFile::isOpen() {
+    return this->mapping != nullptr;
+}
+
+const char* MappedFile::data() {
+    return this->mapping;
+}
+
+uint64_t MappedFile::size() {
+    return this->mappingSize;
+}
+
+bool MappedFile::sectionFits(uint64_t offset, uint64_t count, uint64_t elementSize) {
+    // counts are at most 2^32 + 1 and elements at most 40 bytes, so the product cannot overflow
+    return offset % 8 == 0 && offset <= this->mappingSize && count * elementSize <= this->mappingSize - offset;
+}
+
+bool MappedFile::stringTableFits(uint64_t offset, uint64_t tableSize) {
+    return sectionFits(offset, tableSize, 1) && tableSize > 0 && this->mapping[offset + tableSize - 1] == '\0';
+}
+
+AtomicFileWriter::AtomicFileWriter() {
+    this->written = 0;
+    this->committed = false;
+}
+
+AtomicFileWriter::~AtomicFileWriter() {
+    if (!this->committed && !this->temporary.empty()) {
+        this->file.close();
+        std::remove(this->temporary.c_str());
+    }
+}
+
+bool AtomicFileWriter::open(const std::string& path, bool binary) {
+    this->path = path;
+    // the pid keeps processes writing the same path, like the client and the daemon, apart
+    this->temporary = path + ".tmp" + std::to_string(getpid());
+    this->written = 0;
+    this->committed = false;
+    this->file.open(this->temporary, binary ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+    return this->file.is_open();
+}
+
+const std::string& AtomicFileWriter::temporaryPath() {
+    return this->temporary;
+}
+
+std::ostream& AtomicFileWriter::stream() {
+    return this->file;
+}
+
+void AtomicFileWriter::put(uint64_t offset, const void* data, size_t size) {
+    static const char padding[8] = {0};
+    this->file.write(padding, offset - this->written);
+    this->file.write((const char*)data, size);
+    this->written = offset + size;
+}
+
+bool AtomicFileWriter::commit() {
+    this->file.close();
+    if (this->file.fail() || std::rename(this->temporary.c_str(), this->path.c_str()) != 0) {
+        std::remove(this->temporary.c_str());
+        this->temporary.clear();
+        return false;
+    }
+    this->committed = true;
+    return true;
+}
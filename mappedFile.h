@@ -0,0 +1,64 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_MAPPEDFILE_H
+#define DYNAMORIO_MAPPEDFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// The graph file, the function cache, the function index and the project index share one layout:
+// a header followed by sections that each start 8-byte aligned, used straight from mmap.
+
+// offset of the next section after one ending at the given offset
+uint64_t alignSection(uint64_t offset);
+
+// Read-only mapping of a whole file, unmapped on close or when it goes out of scope.
+class MappedFile {
+private:
+    const char* mapping;
+    size_t mappingSize;
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    // fails without a message when the file is missing, shorter than minimumSize or cannot be mapped,
+    // each format reports the failure in its own words
+    bool open(const std::string& path, size_t minimumSize);
+    void close();
+    bool isOpen();
+    const char* data();
+    uint64_t size();
+    // the section is 8-byte aligned and its count elements lie inside the file
+    bool sectionFits(uint64_t offset, uint64_t count, uint64_t elementSize);
+    // the string table lies inside the file and ends in a terminator, so every offset below its size names a string
+    bool stringTableFits(uint64_t offset, uint64_t tableSize);
+};
+
+// Writes a file under a temporary name and renames it over the destination on commit, so a reader,
+// or a concurrent writer of the same path, never sees half a file. Uncommitted output is removed.
+class AtomicFileWriter {
+private:
+    std::string path;
+    std::string temporary;
+    std::ofstream file;
+    uint64_t written;
+    bool committed;
+public:
+    AtomicFileWriter();
+    ~AtomicFileWriter();
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+    bool open(const std::string& path, bool binary = true);
+    const std::string& temporaryPath();
+    std::ostream& stream();
+    // writes the section at its offset, zero padding after the previous one
+    void put(uint64_t offset, const void* data, size_t size);
+    bool commit();
+};
+
+
+#endif //DYNAMORIO_MAPPEDFILE_H
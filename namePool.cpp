@@ -0,0 +1,36 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "namePool.h"
+
+NamePool::NamePool(std::pmr::memory_resource* resource) : resource(resource), names(resource) {
+}
+
+std::string_view NamePool::intern(std::string_view name) {
+    auto it = this->names.find(name);
+    if (it != this->names.end()) {
+        return *it;
+    }
+    // copy the name into the resource, keep the terminator so data() can be used as a C string
+    char* storage = static_cast<char*>(this->resource->allocate(name.size() + 1, 1));
+    memcpy(storage, name.data(), name.size());
+    storage[name.size()] = '\0';
+    std::string_view interned(storage, name.size());
+    this->names.insert(interned);
+    return interned;
+}
+
+std::string_view NamePool::adopt(std::string_view name) {
+    // register a null-terminated name that outlives the pool (e.g. a mapped graph file) without copying it
+    auto it = this->names.find(name);
+    if (it != this->names.end()) {
+        return *it;
+    }
+    this->names.insert(name);
+    return name;
+}
+
+size_t NamePool::size() {
+    return this->names.size();
+}
@@ -0,0 +1,28 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_NAMEPOOL_H
+#define DYNAMORIO_NAMEPOOL_H
+
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_set>
+
+// Interns function and file names into a memory resource owned by the graph.
+// Every name is stored once, null-terminated, and the returned views stay valid
+// for as long as the resource does.
+class NamePool {
+private:
+    std::pmr::memory_resource* resource;
+    std::pmr::unordered_set<std::string_view> names;
+public:
+    explicit NamePool(std::pmr::memory_resource* resource);
+    std::string_view intern(std::string_view name);
+    std::string_view adopt(std::string_view name);
+    size_t size();
+};
+
+
+#endif //DYNAMORIO_NAMEPOOL_H
@@ -3,11 +3,11 @@
 //
 
 #include "node.h"
+#include <algorithm>
 #define MAX_CALL_DEPTH 256
 
 // start to implement the Node functions
-Node::Node() {
-    this->next = std::vector<Node*>();
+Node::Node(std::pmr::memory_resource* resource) : next(resource), next_call_count(resource), next_threads(resource) {
     this->call_count = 0;
     this->name = "";
 }
@@ -15,7 +15,7 @@ Node::Node() {
 Node::~Node() {
 }
 
-void Node::set_name(std::string name) {
+void Node::set_name(std::string_view name) {
     this->name = name;
 }
 
@@ -23,7 +23,7 @@ void Node::set_next(Node* nextNode) {
     //std::cout << "In set next, Adding call from " << this->name << " to " << nextNode->get_name() << std::endl;
     nextNode->increment_call_count();
     for (int i = 0; i < this->next.size(); i++) {
-        if (this->next[i]->get_name() == nextNode->get_name()) {
+        if (this->next[i] == nextNode) {
             this->next_call_count[i]++;
             return;
         }
@@ -32,19 +32,96 @@ void Node::set_next(Node* nextNode) {
     this->next_call_count.push_back(1);
 }
 
-std::string Node::get_name() {
+void Node::set_next(Node* nextNode, uint32_t thread) {
+    set_next(nextNode);
+    add_thread_calls(nextNode, thread, 1);
+}
+
+void Node::add_thread_calls(Node* nextNode, uint32_t thread, int count) {
+    for (auto& tag : this->next_threads) {
+        if (tag.next == nextNode && tag.thread == thread) {
+            tag.count += count;
+            return;
+        }
+    }
+    this->next_threads.push_back({nextNode, thread, (uint32_t)count});
+}
+
+const std::pmr::vector<ThreadCount>& Node::get_next_threads() {
+    return this->next_threads;
+}
+
+std::vector<ThreadCount> Node::get_threads(Node* nextNode) {
+    std::vector<ThreadCount> threads;
+    for (const auto& tag : this->next_threads) {
+        if (tag.next == nextNode) {
+            threads.push_back(tag);
+        }
+    }
+    return threads;
+}
+
+bool Node::has_thread(Node* nextNode, uint32_t thread) {
+    // an edge without thread information belongs to every thread
+    bool tagged = false;
+    for (const auto& tag : this->next_threads) {
+        if (tag.next == nextNode) {
+            if (tag.thread == thread) {
+                return true;
+            }
+            tagged = true;
+        }
+    }
+    return !tagged;
+}
+
+void Node::add_next(Node* nextNode, int count) {
+    // same as calling set_next count times, used when loading a saved graph
+    nextNode->call_count += count;
+    for (size_t i = 0; i < this->next.size(); i++) {
+        if (this->next[i] == nextNode) {
+            this->next_call_count[i] += count;
+            return;
+        }
+    }
+    this->next.push_back(nextNode);
+    this->next_call_count.push_back(count);
+}
+
+int Node::remove_next(Node* nextNode) {
+    // drops the edge and returns how many calls it carried
+    for (size_t i = 0; i < this->next.size(); i++) {
+        if (this->next[i] == nextNode) {
+            int count = this->next_call_count[i];
+            nextNode->call_count -= count;
+            this->next.erase(this->next.begin() + i);
+            this->next_call_count.erase(this->next_call_count.begin() + i);
+            this->next_threads.erase(std::remove_if(this->next_threads.begin(), this->next_threads.end(),
+                                                    [&](const ThreadCount& tag) { return tag.next == nextNode; }),
+                                     this->next_threads.end());
+            return count;
+        }
+    }
+    return 0;
+}
+
+std::string_view Node::get_name() {
     return this->name;
 }
 
-std::vector<Node*> Node::get_next() {
+const std::pmr::vector<Node*>& Node::get_next() {
     return this->next;
 }
 
+const std::pmr::vector<int>& Node::get_next_call_count() {
+    return this->next_call_count;
+}
+
 int Node::get_call_count() {
     return this->call_count;
 }
 
-int Node::get_call_count(std::string name) {
+int Node::get_call_count(std::string_view name) {
     for (int i = 0; i < this->next.size(); i++) {
         if (this->next[i]->get_name() == name) {
             return this->next_call_count[i];
@@ -57,6 +134,6 @@ void Node::increment_call_count() {
     this->call_count++;
 }
 
-void Node::change_name(std::string name) {
+void Node::change_name(std::string_view name) {
     this->name = name;
 }
\ No newline at end of file
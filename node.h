@@ -10,24 +10,47 @@
 #include <cstring>
 #include <cstdlib>
 #include <vector>
+#include <memory_resource>
+#include <string_view>
+#include <cstdint>
 
 using namespace std;
+class Node;
+// calls along one edge made by one thread, threads are numbered like ASan's T<n>
+struct ThreadCount {
+    Node* next;
+    uint32_t thread;
+    uint32_t count;
+};
+
+// Nodes are allocated from the arena of their Graph and never destroyed one by one,
+// the name must be interned in the NamePool of the same Graph.
 class Node{
 private:
-    string name;
-    std::vector<Node*> next;
-    std::vector<int> next_call_count;
+    std::string_view name;
+    std::pmr::vector<Node*> next;
+    std::pmr::vector<int> next_call_count;
+    // thread tags of the edges, an edge without any tag was recorded without thread information
+    std::pmr::vector<ThreadCount> next_threads;
     int call_count;
 public:
-    Node();
+    explicit Node(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     ~Node();
-    std::string get_name();
-    void change_name(std::string name);
-    std::vector<Node*> get_next();
+    std::string_view get_name();
+    void change_name(std::string_view name);
+    const std::pmr::vector<Node*>& get_next();
+    const std::pmr::vector<int>& get_next_call_count();
     int get_call_count();
-    int get_call_count(std::string name);
-    void set_name(std::string name);
+    int get_call_count(std::string_view name);
+    void set_name(std::string_view name);
     void set_next(Node* next);
+    void set_next(Node* next, uint32_t thread);
+    void add_next(Node* next, int count);
+    void add_thread_calls(Node* next, uint32_t thread, int count);
+    const std::pmr::vector<ThreadCount>& get_next_threads();
+    std::vector<ThreadCount> get_threads(Node* next);
+    bool has_thread(Node* next, uint32_t thread);
+    int remove_next(Node* next);
     void increment_call_count();
 };
 
@@ -0,0 +1,124 @@
+//
+// Created by mxu49 on 2026/10/18.
+// g++ -std=c++17 -O2 -o preprocessBench preprocessBench.cpp codePreprocessor.cpp
+//
+// Compares the single-pass preprocessSource with the former regex based
+// StaticAnalyzer::preprocessCode on the cases of preprocess.cpp and times both.
+//
+#include <chrono>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "codePreprocessor.h"
+
+// StaticAnalyzer::preprocessCode before the scanner, kept as the reference
+static std::string legacyPreprocessCode(const std::string& code) {
+    std::string output;
+    std::istringstream stream(code);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::regex cast_regex(R"((reinterpret_cast|static_cast|dynamic_cast|const_cast)\s*<\s*([^>]+)\s*>\s*\(\s*([^()]+)\s*\))");
+        line = std::regex_replace(line, cast_regex, "$3");
+        std::regex c_cast_regex(R"(\(\s*[a-zA-Z_:][a-zA-Z0-9_:<>\*\&\s]*\s*\)\s*([a-zA-Z_][a-zA-Z0-9_]*)\b)");
+        line = std::regex_replace(line, c_cast_regex, "$1");
+        std::regex sizeof_with_parentheses_regex(R"(sizeof\s*\(\s*([^()]+?)\s*\))");
+        line = std::regex_replace(line, sizeof_with_parentheses_regex, "$1");
+        std::regex sizeof_without_parentheses_regex(R"(sizeof\s+([a-zA-Z_:][a-zA-Z0-9_:<>]*))");
+        line = std::regex_replace(line, sizeof_without_parentheses_regex, "$1");
+
+        size_t comment_pos = line.find("//");
+        if (comment_pos != std::string::npos) {
+            line = line.substr(0, comment_pos);
+        }
+        size_t comment_start = line.find("/*");
+        size_t comment_end = line.find("*/");
+        if (comment_start != std::string::npos && comment_end != std::string::npos) {
+            line = line.substr(0, comment_start) + line.substr(comment_end + 2);
+        }
+        if (line.empty()) continue;
+        std::size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos) {
+            std::size_t end = line.find_last_not_of(" \t");
+            line = line.substr(start, end - start + 1);
+        }
+        size_t quote_start = line.find("\"");
+        size_t quote_end = line.find("\"", quote_start + 1);
+        while (quote_start != std::string::npos && quote_end != std::string::npos) {
+            line = line.substr(0, quote_start) + line.substr(quote_end + 1);
+            quote_start = line.find("\"");
+            quote_end = line.find("\"", quote_start + 1);
+        }
+        output += line + " ";
+    }
+    return output;
+}
+
+template <typename F>
+static double timePerCall(F function, const std::vector<std::string>& inputs, int rounds) {
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const auto& input : inputs) {
+            sink += function(input).size();
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    if (sink == 0) {
+        std::cout << std::endl;
+    }
+    return elapsed.count() / (rounds * inputs.size());
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+    // the statements of preprocess.cpp, then comments and literals the regexes handled per line
+    std::vector<std::string> cases = {
+            "int var = (int)memcpy(&smallBuffer, &largeBuffer, sizeof(int));",
+            "int size = sizeof int;",
+            "double total = static_cast<double>(sizeof(a + b));",
+            "auto len = reinterpret_cast<std::vector<int>*>(malloc(sizeof(std::vector<int>)));",
+            "float f = (float)(sizeof(char) + static_cast<float>(sizeof(double)));",
+            "int size = sizeof(sizeof(int));",
+            "void* p = sizeof(void*);",
+            "auto ptr = const_cast<char*>(malloc(sizeof(char) * 10));",
+            "int* ptr = (int*)malloc( sizeof(int) * 5 );",
+            "size_t len = sizeof(myStruct);",
+            "auto ptr = dynamic_cast<std::map<std::string, int>*>(getMap());",
+            "double* dp = (double*)malloc(sizeof(double) * 10);",
+            "int x = static_cast<int>(y);",
+            "auto buffer = (char*)malloc(sizeof(char) * sizeof(int));",
+            "int size = sizeof(a + b * c);",
+            "    copy(dst, src, n); // trailing comment\n\n  return n;",
+            "int a = 1; /* a block comment\n   over two lines */ int b = a;",
+            "printf(\"%s: \\\"%d\\\"\\n\", name, value);",
+            "if (len) memcpy(buf, \"/* not a comment */\", len);",
+            "char quote = '\"'; int n = strlen(s);",
+    };
+    int same = 0;
+    for (const auto& input : cases) {
+        std::string legacy = legacyPreprocessCode(input);
+        std::string scanned = preprocessSource(input);
+        same += legacy == scanned;
+        std::cout << "Input:   " << input << "\n";
+        std::cout << "Legacy:  " << legacy << "\n";
+        std::cout << "Scanner: " << scanned << "\n\n";
+    }
+    std::cout << same << " of " << cases.size() << " cases give the same output" << std::endl;
+
+    // a function body of a few hundred lines, the size srcML usually gets
+    std::string body;
+    for (int i = 0; i < 20; i++) {
+        for (const auto& input : cases) {
+            body += input + "\n";
+        }
+    }
+    std::vector<std::string> bodies = {body};
+
+    std::cout << "statements: legacy " << timePerCall(legacyPreprocessCode, cases, rounds) << " us, scanner "
+              << timePerCall(preprocessSource, cases, rounds) << " us per call" << std::endl;
+    std::cout << "function:   legacy " << timePerCall(legacyPreprocessCode, bodies, rounds / 20 + 1) << " us, scanner "
+              << timePerCall(preprocessSource, bodies, rounds / 20 + 1) << " us per call" << std::endl;
+    return 0;
+}
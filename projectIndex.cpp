@@ -0,0 +1,242 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "projectIndex.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+ProjectIndex::ProjectIndex() {
+    this->header = NULL;
+    this->files = NULL;
+    this->functions = NULL;
+}
+
+ProjectIndex::~ProjectIndex() {
+    close();
+}
+
+bool ProjectIndex::open(const std::string& path) {
+    close();
+    if (!this->file.open(path, sizeof(ProjectIndexHeader))) {
+        std::cerr << "Error: unable to map project index " << path << std::endl;
+        return false;
+    }
+    this->header = (const ProjectIndexHeader*)this->file.data();
+
+    const ProjectIndexHeader* h = this->header;
+    if (memcmp(h->magic, PROJECT_INDEX_MAGIC, sizeof(PROJECT_INDEX_MAGIC)) != 0) {
+        std::cerr << "Error: " << path << " is not a project index" << std::endl;
+        close();
+        return false;
+    }
+    if (h->version != PROJECT_INDEX_VERSION || h->analyzerVersion != FUNCTION_CACHE_ANALYZER_VERSION) {
+        std::cerr << "Error: " << path << " was written by another version of the analyzer, run indexProject again" << std::endl;
+        close();
+        return false;
+    }
+    // every section has to lie inside the file before anything is read from it
+    if (!this->file.sectionFits(h->filesOffset, h->fileCount, sizeof(ProjectIndexFile)) ||
+        !this->file.sectionFits(h->functionsOffset, h->functionCount, sizeof(ProjectIndexFunction)) ||
+        !this->file.sectionFits(h->elementsOffset, h->elementCount, sizeof(FunctionCacheElement)) ||
+        !this->file.sectionFits(h->variablesOffset, h->variableCount, 4) ||
+        !this->file.sectionFits(h->callsOffset, h->callCount, sizeof(FunctionCacheCall)) ||
+        !this->file.sectionFits(h->argumentsOffset, h->argumentCount, sizeof(FunctionCacheArgument)) ||
+        !this->file.stringTableFits(h->stringTableOffset, h->stringTableSize)) {
+        std::cerr << "Error: " << path << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+    this->files = (const ProjectIndexFile*)(this->file.data() + h->filesOffset);
+    this->functions = (const ProjectIndexFunction*)(this->file.data() + h->functionsOffset);
+    for (uint32_t i = 0; i < h->functionCount; i++) {
+        if (this->functions[i].file >= h->fileCount) {
+            std::cerr << "Error: " << path << " is corrupt" << std::endl;
+            close();
+            return false;
+        }
+    }
+    this->fileStates.assign(h->fileCount, 0);
+    return true;
+}
+
+void ProjectIndex::close() {
+    this->file.close();
+    this->header = NULL;
+    this->files = NULL;
+    this->functions = NULL;
+    this->fileStates.clear();
+}
+
+uint32_t ProjectIndex::functionCount() {
+    return this->header == NULL ? 0 : this->header->functionCount;
+}
+
+std::string_view ProjectIndex::string(uint32_t offset) {
+    if (offset >= this->header->stringTableSize) {
+        return "";
+    }
+    return std::string_view(this->file.data() + this->header->stringTableOffset + offset);
+}
+
+std::vector<uint32_t> ProjectIndex::find(std::string_view name) {
+    std::vector<uint32_t> found;
+    if (this->header == NULL) {
+        return found;
+    }
+    const ProjectIndexFunction* begin = this->functions;
+    const ProjectIndexFunction* end = this->functions + this->header->functionCount;
+    const ProjectIndexFunction* first = std::lower_bound(begin, end, name, [this](const ProjectIndexFunction& f, std::string_view n) {
+        return string(f.name) < n;
+    });
+    const ProjectIndexFunction* last = std::upper_bound(first, end, name, [this](std::string_view n, const ProjectIndexFunction& f) {
+        return n < string(f.name);
+    });
+    for (const ProjectIndexFunction* it = first; it != last; it++) {
+        found.push_back(it - begin);
+    }
+    return found;
+}
+
+// the indexer stores absolute paths and the function index makes DWARF's relative ones absolute against the
+// unit's compilation directory, so only ".." and "." are left to fold; a path still relative, from a unit
+// without DW_AT_comp_dir, is not resolved against the working directory and simply matches nothing
+static std::string normalizePath(const std::string& path) {
+    return std::filesystem::path(path).lexically_normal().string();
+}
+
+bool ProjectIndex::isCurrent(uint32_t file) {
+    // like the function cache, a file is hashed once per run
+    if (this->fileStates[file] == 0) {
+        uint64_t hash;
+        std::string path(string(this->files[file].path));
+        bool current = hashSourceFile(path, hash) && hash == this->files[file].contentHash;
+        if (!current) {
+            std::cout << path << " changed since it was indexed, its functions are parsed again" << std::endl;
+        }
+        this->fileStates[file] = current ? 1 : -1;
+    }
+    return this->fileStates[file] == 1;
+}
+
+int64_t ProjectIndex::findAt(std::string_view name, const std::string& file, int start_line, int end_line) {
+    std::string normalized = normalizePath(file);
+    for (uint32_t function : find(name)) {
+        const ProjectIndexFunction& f = this->functions[function];
+        if (string(this->files[f.file].path) == normalized && f.startLine <= end_line && start_line <= f.endLine) {
+            return isCurrent(f.file) ? (int64_t)function : -1;
+        }
+    }
+    return -1;
+}
+
+void ProjectIndex::forgetFile(const std::string& file) {
+    if (this->header == NULL) {
+        return;
+    }
+    std::string normalized = normalizePath(file);
+    for (uint32_t i = 0; i < this->header->fileCount; i++) {
+        if (string(this->files[i].path) == normalized) {
+            this->fileStates[i] = 0;
+        }
+    }
+}
+
+std::vector<CodeElement> ProjectIndex::elements(uint32_t function) {
+    const ProjectIndexHeader* h = this->header;
+    const ProjectIndexFunction& f = this->functions[function];
+    const char* mapping = this->file.data();
+    MappedElementSections sections;
+    sections.elements = (const FunctionCacheElement*)(mapping + h->elementsOffset);
+    sections.variables = (const uint32_t*)(mapping + h->variablesOffset);
+    sections.variableCount = h->variableCount;
+    sections.calls = (const FunctionCacheCall*)(mapping + h->callsOffset);
+    sections.callCount = h->callCount;
+    sections.arguments = (const FunctionCacheArgument*)(mapping + h->argumentsOffset);
+    sections.argumentCount = h->argumentCount;
+    sections.strings = mapping + h->stringTableOffset;
+    sections.stringTableSize = h->stringTableSize;
+    std::vector<CodeElement> elements;
+    for (uint32_t i = f.elementsBegin; i < f.elementsEnd && i < h->elementCount; i++) {
+        elements.push_back(sections.element(i));
+    }
+    return elements;
+}
+
+bool ProjectIndex::write(const std::string& path, std::vector<IndexedFunction>& indexed) {
+    // sorted by name for the binary search, then by place so the file does not depend on thread timing
+    std::sort(indexed.begin(), indexed.end(), [](const IndexedFunction& a, const IndexedFunction& b) {
+        return std::tie(a.name, a.file, a.startLine) < std::tie(b.name, b.file, b.startLine);
+    });
+
+    ElementSections sections;
+    std::vector<ProjectIndexFile> files;
+    std::unordered_map<std::string, uint32_t> fileIds;
+    std::vector<ProjectIndexFunction> functions;
+    for (const auto& function : indexed) {
+        std::string path = normalizePath(function.file);
+        auto inserted = fileIds.emplace(path, files.size());
+        if (inserted.second) {
+            files.push_back({sections.addString(path), 0, function.contentHash});
+        }
+        ProjectIndexFunction f;
+        f.name = sections.addString(function.name);
+        f.file = inserted.first->second;
+        f.startLine = function.startLine;
+        f.endLine = function.endLine;
+        f.elementsBegin = sections.elements.size();
+        for (const auto& element : function.elements) {
+            sections.addElement(element);
+        }
+        f.elementsEnd = sections.elements.size();
+        functions.push_back(f);
+    }
+
+    ProjectIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PROJECT_INDEX_MAGIC, sizeof(PROJECT_INDEX_MAGIC));
+    header.version = PROJECT_INDEX_VERSION;
+    header.analyzerVersion = FUNCTION_CACHE_ANALYZER_VERSION;
+    header.fileCount = files.size();
+    header.functionCount = functions.size();
+    header.elementCount = sections.elements.size();
+    header.variableCount = sections.variables.size();
+    header.callCount = sections.calls.size();
+    header.argumentCount = sections.arguments.size();
+    header.stringTableSize = sections.strings.size();
+    uint64_t offset = alignSection(sizeof(header));
+    header.filesOffset = offset;
+    offset = alignSection(offset + files.size() * sizeof(ProjectIndexFile));
+    header.functionsOffset = offset;
+    offset = alignSection(offset + functions.size() * sizeof(ProjectIndexFunction));
+    header.elementsOffset = offset;
+    offset = alignSection(offset + sections.elements.size() * sizeof(FunctionCacheElement));
+    header.variablesOffset = offset;
+    offset = alignSection(offset + sections.variables.size() * 4);
+    header.callsOffset = offset;
+    offset = alignSection(offset + sections.calls.size() * sizeof(FunctionCacheCall));
+    header.argumentsOffset = offset;
+    offset = alignSection(offset + sections.arguments.size() * sizeof(FunctionCacheArgument));
+    header.stringTableOffset = offset;
+
+    AtomicFileWriter file;
+    if (!file.open(path)) {
+        std::cerr << "Error: unable to open file " << file.temporaryPath() << std::endl;
+        return false;
+    }
+    file.put(0, &header, sizeof(header));
+    file.put(header.filesOffset, files.data(), files.size() * sizeof(ProjectIndexFile));
+    file.put(header.functionsOffset, functions.data(), functions.size() * sizeof(ProjectIndexFunction));
+    file.put(header.elementsOffset, sections.elements.data(), sections.elements.size() * sizeof(FunctionCacheElement));
+    file.put(header.variablesOffset, sections.variables.data(), sections.variables.size() * 4);
+    file.put(header.callsOffset, sections.calls.data(), sections.calls.size() * sizeof(FunctionCacheCall));
+    file.put(header.argumentsOffset, sections.arguments.data(), sections.arguments.size() * sizeof(FunctionCacheArgument));
+    file.put(header.stringTableOffset, sections.strings.data(), sections.strings.size());
+    if (!file.commit()) {
+        std::cerr << "Error: unable to write project index " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_PROJECTINDEX_H
+#define DYNAMORIO_PROJECTINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "functionCache.h"
+#include "mappedFile.h"
+
+// Parsed functions of a whole source tree, written once by indexProject and mapped by the
+// analysis, so Traversal looks functions up instead of parsing them:
+//   header | files | functions (sorted by name) | elements | variables | calls | arguments | string table
+// Elements, variables, calls and arguments are laid out as in a function cache entry.
+// Every file records the hash of its contents, the functions of a file edited since it was indexed are parsed again.
+#define PROJECT_INDEX_MAGIC "PFPROJ"
+#define PROJECT_INDEX_VERSION 3
+
+struct ProjectIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t analyzerVersion;      // FUNCTION_CACHE_ANALYZER_VERSION of the indexer
+    uint32_t fileCount;
+    uint32_t functionCount;
+    uint32_t elementCount;
+    uint32_t variableCount;
+    uint32_t callCount;
+    uint32_t argumentCount;
+    uint32_t stringTableSize;
+    uint32_t reserved;
+    uint64_t filesOffset;          // ProjectIndexFile[fileCount]
+    uint64_t functionsOffset;      // ProjectIndexFunction[functionCount]
+    uint64_t elementsOffset;       // FunctionCacheElement[elementCount]
+    uint64_t variablesOffset;      // uint32_t[variableCount], offsets into the string table
+    uint64_t callsOffset;          // FunctionCacheCall[callCount]
+    uint64_t argumentsOffset;      // FunctionCacheArgument[argumentCount]
+    uint64_t stringTableOffset;
+};
+
+struct ProjectIndexFile {
+    uint32_t path;                 // absolute and normalized
+    uint32_t reserved;
+    uint64_t contentHash;          // fnv1a of the file when it was indexed
+};
+
+struct ProjectIndexFunction {
+    uint32_t name;
+    uint32_t file;                 // index into the files
+    int32_t startLine;
+    int32_t endLine;
+    uint32_t elementsBegin;        // elements of the function are [elementsBegin, elementsEnd)
+    uint32_t elementsEnd;
+};
+
+// one function as the indexer found it
+struct IndexedFunction {
+    std::string name;
+    std::string file;
+    uint64_t contentHash;
+    int startLine;
+    int endLine;
+    std::vector<CodeElement> elements;
+};
+
+class ProjectIndex {
+private:
+    MappedFile file;
+    const ProjectIndexHeader* header;
+    const ProjectIndexFile* files;
+    const ProjectIndexFunction* functions;
+    // per file: 0 not checked yet, 1 unchanged since it was indexed, -1 changed or gone
+    std::vector<int8_t> fileStates;
+    std::string_view string(uint32_t offset);
+    bool isCurrent(uint32_t file);
+public:
+    ProjectIndex();
+    ~ProjectIndex();
+    ProjectIndex(const ProjectIndex&) = delete;
+    ProjectIndex& operator=(const ProjectIndex&) = delete;
+    bool open(const std::string& path);
+    void close();
+    uint32_t functionCount();
+    // every definition of the name, static functions of different files share one
+    std::vector<uint32_t> find(std::string_view name);
+    std::vector<CodeElement> elements(uint32_t function);
+    // the definition of the name in the file whose lines overlap the given ones, -1 when there is none
+    // or the file changed since it was indexed; paths are compared after normalizing both
+    int64_t findAt(std::string_view name, const std::string& file, int start_line, int end_line);
+    // hashes the file again on its next use, after it changed on disk
+    void forgetFile(const std::string& file);
+    static bool write(const std::string& path, std::vector<IndexedFunction>& indexed);
+};
+
+
+#endif //DYNAMORIO_PROJECTINDEX_H
@@ -0,0 +1,132 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "sourceStore.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+SourceFile::SourceFile(std::string text) {
+    this->text = std::move(text);
+    const char* data = this->text.data();
+    size_t size = this->text.size();
+    this->lineStarts.push_back(0);
+    for (const char* p = data; p < data + size; ) {
+        const char* newline = (const char*)memchr(p, '\n', data + size - p);
+        if (newline == NULL || newline + 1 == data + size) {
+            break;
+        }
+        this->lineStarts.push_back(newline + 1 - data);
+        p = newline + 1;
+    }
+}
+
+std::string_view SourceFile::lines(int first_line, int last_line) const {
+    if (first_line < 1) {
+        first_line = 1;
+    }
+    if (this->text.empty() || first_line > last_line || first_line > (int)this->lineStarts.size()) {
+        return std::string_view();
+    }
+    size_t begin = this->lineStarts[first_line - 1];
+    size_t end = last_line < (int)this->lineStarts.size() ? this->lineStarts[last_line] : this->text.size();
+    return std::string_view(this->text.data() + begin, end - begin);
+}
+
+size_t SourceFile::lineCount() const {
+    return this->text.empty() ? 0 : this->lineStarts.size();
+}
+
+static FileStamp stampOf(const struct stat* st) {
+    FileStamp stamp = {st != NULL, 0, {0, 0}};
+    if (st != NULL) {
+        stamp.size = st->st_size;
+        stamp.modified = st->st_mtim;
+    }
+    return stamp;
+}
+
+static bool sameStamp(const FileStamp& a, const FileStamp& b) {
+    return a.exists == b.exists && a.size == b.size && a.modified.tv_sec == b.modified.tv_sec &&
+           a.modified.tv_nsec == b.modified.tv_nsec;
+}
+
+const SourceFile* SourceStore::open(const std::string& file_name) {
+    auto it = this->files.find(file_name);
+    if (it != this->files.end()) {
+        return it->second.get();
+    }
+    // the file is copied rather than mapped, a mapping of a file truncated later raises SIGBUS on access
+    // a file that could not be read is stamped as missing, so the next refresh tries it again once it is there
+    std::unique_ptr<SourceFile>& file = this->files[file_name];
+    this->stamps[file_name] = stampOf(NULL);
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error: unable to open file " << file_name << std::endl;
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        std::cerr << "Error: unable to open file " << file_name << std::endl;
+        return NULL;
+    }
+    std::string text(st.st_size, '\0');
+    size_t done = 0;
+    while (done < text.size()) {
+        ssize_t count = read(fd, &text[done], text.size() - done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            close(fd);
+            std::cerr << "Error: unable to read file " << file_name << std::endl;
+            return NULL;
+        }
+        if (count == 0) {
+            // truncated while being read, the next refresh sees the new size and drops it
+            break;
+        }
+        done += count;
+    }
+    close(fd);
+    text.resize(done);
+    this->stamps[file_name] = stampOf(&st);
+    file = std::make_unique<SourceFile>(std::move(text));
+    return file.get();
+}
+
+void SourceStore::watch(const std::string& file_name) {
+    if (this->stamps.find(file_name) != this->stamps.end()) {
+        return;
+    }
+    struct stat st;
+    this->stamps[file_name] = stampOf(stat(file_name.c_str(), &st) == 0 ? &st : NULL);
+}
+
+std::vector<std::string> SourceStore::refresh() {
+    std::vector<std::string> changed;
+    for (auto it = this->stamps.begin(); it != this->stamps.end(); ) {
+        struct stat st;
+        if (sameStamp(it->second, stampOf(stat(it->first.c_str(), &st) == 0 ? &st : NULL))) {
+            it++;
+            continue;
+        }
+        changed.push_back(it->first);
+        this->files.erase(it->first);
+        it = this->stamps.erase(it);
+    }
+    return changed;
+}
+
+bool SourceStore::lines(const std::string& file_name, int first_line, int last_line, std::string_view& text) {
+    const SourceFile* file = open(file_name);
+    if (file == NULL) {
+        return false;
+    }
+    text = file->lines(first_line, last_line);
+    return true;
+}
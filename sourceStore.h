@@ -0,0 +1,56 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_SOURCESTORE_H
+#define DYNAMORIO_SOURCESTORE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+
+// A source file read once into memory, with the offset of every line start.
+class SourceFile {
+private:
+    std::string text;
+    std::vector<size_t> lineStarts;
+public:
+    explicit SourceFile(std::string text);
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+    // lines [first_line, last_line], 1-based and inclusive like awk's NR, clamped to the file
+    std::string_view lines(int first_line, int last_line) const;
+    size_t lineCount() const;
+};
+
+// size and modification time of a file when it was first used, exists is false for a missing file
+struct FileStamp {
+    bool exists;
+    off_t size;
+    struct timespec modified;
+};
+
+// Source files shared by every function and path of a run, each file is read on first use
+// and function bodies are views into its copy. Lookups do not go back to the disk: refresh()
+// compares every file in use with its stamp and drops the ones that changed, so a view stays
+// valid until the next refresh(). The graph refreshes only at the start of a query.
+class SourceStore {
+private:
+    // a file that could not be opened is kept as NULL so it is reported only once
+    std::unordered_map<std::string, std::unique_ptr<SourceFile>> files;
+    // every file read or watched, whether or not its text is held here
+    std::unordered_map<std::string, FileStamp> stamps;
+public:
+    const SourceFile* open(const std::string& file_name);
+    bool lines(const std::string& file_name, int first_line, int last_line, std::string_view& text);
+    // stamps a file whose contents were used without reading them here, e.g. from a cache
+    void watch(const std::string& file_name);
+    // forgets every file that changed since it was stamped and returns their names
+    std::vector<std::string> refresh();
+};
+
+
+#endif //DYNAMORIO_SOURCESTORE_H
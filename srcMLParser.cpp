@@ -0,0 +1,97 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "srcMLParser.h"
+#include <iostream>
+#include <libxml/parser.h>
+
+SrcMLParser::SrcMLParser() {
+    this->archive = srcml_archive_create();
+    srcml_archive_set_language(this->archive, SRCML_LANGUAGE_CXX);
+    srcml_archive_enable_option(this->archive, SRCML_OPTION_POSITION);
+    // a single unit is written as the document root, without an archive around it
+    srcml_archive_enable_solitary_unit(this->archive);
+}
+
+SrcMLParser::~SrcMLParser() {
+    srcml_archive_free(this->archive);
+}
+
+bool SrcMLParser::writeUnit(struct srcml_archive* output, const std::string& code) {
+    struct srcml_unit* unit = srcml_unit_create(output);
+    srcml_unit_set_language(unit, SRCML_LANGUAGE_CXX);
+    bool parsed = srcml_unit_parse_memory(unit, code.c_str(), code.size()) == SRCML_STATUS_OK &&
+                  srcml_archive_write_unit(output, unit) == SRCML_STATUS_OK;
+    srcml_unit_free(unit);
+    return parsed;
+}
+
+bool SrcMLParser::parse(const std::string& code, std::string& xml) {
+    struct srcml_archive* output = srcml_archive_clone(this->archive);
+    char* buffer = nullptr;
+    size_t size = 0;
+    if (output == nullptr || srcml_archive_write_open_memory(output, &buffer, &size) != SRCML_STATUS_OK) {
+        std::cerr << "Error: unable to create srcML archive" << std::endl;
+        srcml_archive_free(output);
+        return false;
+    }
+
+    bool parsed = writeUnit(output, code);
+    // the memory buffer is only complete once the archive is closed
+    srcml_archive_close(output);
+    srcml_archive_free(output);
+    if (parsed && buffer != nullptr) {
+        xml.assign(buffer, size);
+    } else {
+        std::cerr << "Error: srcML failed to parse " << code.substr(0, 80) << std::endl;
+    }
+    srcml_memory_free(buffer);
+    return parsed;
+}
+
+xmlDocPtr SrcMLParser::parseDocument(const std::string& code) {
+    std::string xml;
+    if (!parse(code, xml)) {
+        return NULL;
+    }
+    return xmlReadMemory(xml.c_str(), xml.size(), NULL, NULL, 0);
+}
+
+static ssize_t writeToParser(void* context, const char* buffer, size_t len) {
+    if (xmlParseChunk((xmlParserCtxtPtr)context, buffer, len, 0) != 0) {
+        return -1;
+    }
+    return len;
+}
+
+static int closeParser(void*) {
+    return 0;
+}
+
+bool SrcMLParser::parseStream(const std::string& code, xmlSAXHandler* handler, void* userData) {
+    xmlParserCtxtPtr parser = xmlCreatePushParserCtxt(handler, userData, NULL, 0, NULL);
+    struct srcml_archive* output = srcml_archive_clone(this->archive);
+    if (parser == NULL || output == nullptr ||
+        srcml_archive_write_open_io(output, parser, writeToParser, closeParser) != SRCML_STATUS_OK) {
+        std::cerr << "Error: unable to create srcML archive" << std::endl;
+        srcml_archive_free(output);
+        if (parser != NULL) {
+            xmlFreeParserCtxt(parser);
+        }
+        return false;
+    }
+
+    bool parsed = writeUnit(output, code);
+    srcml_archive_close(output);
+    srcml_archive_free(output);
+    // ending the document makes the parser hand over what it still buffers
+    bool wellFormed = xmlParseChunk(parser, NULL, 0, 1) == 0 && parser->wellFormed;
+    xmlFreeParserCtxt(parser);
+    if (!parsed) {
+        std::cerr << "Error: srcML failed to parse " << code.substr(0, 80) << std::endl;
+    } else if (!wellFormed) {
+        std::cerr << "Error: srcML output of " << code.substr(0, 80) << " is not well-formed" << std::endl;
+    }
+    return parsed && wellFormed;
+}
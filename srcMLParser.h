@@ -0,0 +1,35 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_SRCMLPARSER_H
+#define DYNAMORIO_SRCMLPARSER_H
+
+#include <string>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include <srcml.h>
+
+// Runs srcML in-process through libsrcml, the source is handed over from memory
+// instead of being quoted into an "echo ... | srcml" shell command.
+// The output is the same document the command line tool prints for
+// "srcml --language=C++ --position".
+class SrcMLParser {
+private:
+    // configured once, every parse writes into a clone of it
+    struct srcml_archive* archive;
+    bool writeUnit(struct srcml_archive* output, const std::string& code);
+public:
+    SrcMLParser();
+    ~SrcMLParser();
+    SrcMLParser(const SrcMLParser&) = delete;
+    SrcMLParser& operator=(const SrcMLParser&) = delete;
+    bool parse(const std::string& code, std::string& xml);
+    xmlDocPtr parseDocument(const std::string& code);
+    // hands the output to a SAX handler while srcML writes it, so no document is built; libsrcml still
+    // holds the whole unit's srcML text in memory from srcml_unit_parse_memory until the write ends
+    bool parseStream(const std::string& code, xmlSAXHandler* handler, void* userData);
+};
+
+
+#endif //DYNAMORIO_SRCMLPARSER_H
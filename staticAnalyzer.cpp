@@ -3,18 +3,12 @@
 //
 
 #include "staticAnalyzer.h"
-
-xmlNode* StaticAnalyzer::findChildByName(xmlNode* node, const char* name) {
-    for (xmlNode* child = node->children; child; child = child->next) {
-        if (child->type == XML_ELEMENT_NODE && !xmlStrcmp(child->name, (const xmlChar*)name)) {
-            return child;
-        }
-    }
-    return nullptr;
-}
-
-
-
+#include "codePreprocessor.h"
+#include "elementStream.h"
+#include "elfFile.h"
+#include "functionCache.h"
+#include "mappedFile.h"
+#include <nlohmann/json.hpp>
 
 bool StaticAnalyzer::isdigit(const std::string& str) {
     return std::all_of(str.begin(), str.end(), ::isdigit);
@@ -68,55 +62,6 @@ ClassificationType StaticAnalyzer::classifyElement(xmlNode *node) {
 }
 
 
-std::vector<CodeElement> StaticAnalyzer::parseElements(xmlNode *node, const std::string& currentFunction) {
-    std::vector<CodeElement> elements;
-
-    if (node == NULL) return elements;
-
-    std::string functionContext = currentFunction;
-    if (node->type == XML_ELEMENT_NODE && !xmlStrcmp(node->name, (const xmlChar *)"function")) {
-        // Assuming the function name is directly under a <name> child of <function>
-        xmlNode* nameNode = findChildByName(node, "name");
-        if (nameNode) {
-            xmlChar* functionName = xmlNodeGetContent(nameNode);
-            if (functionName) {
-                functionContext = (char*)functionName;
-                xmlFree(functionName);
-            }
-        }
-    }
-
-    // Recursively process all children to find relevant code elements
-    for (xmlNode *child = node->children; child; child = child->next) {
-        if (isIgnoredElement(child)) continue;
-        auto childElements = parseElements(child, functionContext);
-        elements.insert(elements.end(), childElements.begin(), childElements.end());
-    }
-
-    // Process the current node if it's of an valid type
-    if (node->type == XML_ELEMENT_NODE) {
-        xmlChar* content = xmlNodeGetContent(node);
-        if (isValidExpression((char*)content, node->name)) {
-            // for each valid expression, we need to copy the node
-            // and then remove the child node of type "type"
-            // and then update the content
-            xmlNode* typeNode = findChildByName(node, "type");
-            if (typeNode) {
-                xmlUnlinkNode(typeNode);
-                xmlFreeNode(typeNode);
-            }
-            content = xmlNodeGetContent(node);
-
-
-            elements.push_back({std::string((char*)node->name), std::string((char*)content), functionContext});
-        }
-        xmlFree(content);
-    }
-
-    return elements;
-}
-
-
 void StaticAnalyzer::printElements(const std::vector<CodeElement>& elements) {
     for (const auto& elem : elements) {
         std::cout << "Function: " << elem.functionName << ", Type: " << elem.type << ", Content: " << elem.content << std::endl;
@@ -125,257 +70,28 @@ void StaticAnalyzer::printElements(const std::vector<CodeElement>& elements) {
 
 
 
-bool StaticAnalyzer::isIgnoredElement(xmlNode* node) {
-    return (!xmlStrcmp(node->name, (const xmlChar *)"comment") ||
-            !xmlStrcmp(node->name, (const xmlChar *)"function_decl") ||
-            !xmlStrcmp(node->name, (const xmlChar *)"type") );
-}
-
-
-bool StaticAnalyzer::isValidExpression(char* content, const xmlChar* nodeName) {
-    // Simplified checks for assignment or comparison within the expression
-    return ( !xmlStrcmp(nodeName, (const xmlChar *)"decl") ||
-            (!xmlStrcmp(nodeName, (const xmlChar *)"parameter")) ||
-             (!xmlStrcmp(nodeName, (const xmlChar *)"return")) ||
-             (!xmlStrcmp(nodeName, (const xmlChar *)"call")) ||
-             (!xmlStrcmp(nodeName, (const xmlChar *)"expr") && (strstr(content, "=") || strstr(content, "==") ||
-                                                                strstr(content, "<") || strstr(content, ">") ||
-                                                                strstr(content, "+") || strstr(content, "-") ||
-                                                                strstr(content, "*") || strstr(content, "/") )));
+xmlDocPtr StaticAnalyzer::parseSource(const std::string& code) {
+    return srcml.parseDocument(code);
 }
 
-std::vector<std::string> StaticAnalyzer::extractVariablesFromXML(const std::string& xml){
-
-    std::vector<std::string> variables;
-
-    // 初始化 libxml
-    xmlInitParser();
-
-    // 从内存中解析 XML
-    xmlDocPtr doc = xmlReadMemory(xml.c_str(), xml.length(), "noname.xml", NULL, XML_PARSE_NOBLANKS);
-    if (doc == NULL) {
-        std::cerr << "Error: unable to parse XML." << std::endl;
-        return variables;
+// Parses the source lines of one function into its elements, used alike by online visits and indexProject
+std::vector<CodeElement> StaticAnalyzer::extractElements(std::string_view body) {
+    //strip the leading meaningless characters, start with the definition of the function
+    size_t pos = body.find_first_not_of('}');
+    if (pos != std::string_view::npos) {
+        body.remove_prefix(pos);
     }
+    std::string code = preprocessCode(body);
 
-    // 创建 XPath 上下文
-    xmlXPathContextPtr xpathCtx = xmlXPathNewContext(doc);
-    if (xpathCtx == NULL) {
-        std::cerr << "Error: unable to create new XPath context." << std::endl;
-        xmlFreeDoc(doc);
-        return variables;
+    // the elements are taken from the srcML output as it is written, no document of the function is built
+    ElementStream stream;
+    xmlSAXHandler handler = ElementStream::saxHandler();
+    if (!srcml.parseStream(code, &handler, &stream)) {
+        return {};
     }
-
-    // 注册 'src' 命名空间
-    if (xmlXPathRegisterNs(xpathCtx, BAD_CAST "src", BAD_CAST "http://www.srcML.org/srcML/src") != 0) {
-        std::cerr << "Error: unable to register namespace." << std::endl;
-        xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
-        return variables;
-    }
-
-    // 调整后的 XPath 表达式：
-    // 选择所有 <src:name> 元素，这些元素：
-    // - 不位于 <src:type> 的后代
-    // - 不位于 <src:call> 或 <src:macro> 的子节点
-    // - 不紧跟在 <src:operator> '->' 之后
-    const xmlChar* xpathExpr = BAD_CAST "//src:name["
-                                        "not(ancestor::src:type) and "
-                                        "not(parent::src:call) and "
-                                        "not(parent::src:macro) and "
-                                        "not(preceding-sibling::src:operator[text()='-&gt;']) and "
-                                        "not(child::src:index)"
-                                        "]";
-
-    xmlXPathObjectPtr nameNodesResult = xmlXPathEvalExpression(xpathExpr, xpathCtx);
-
-    if (nameNodesResult && nameNodesResult->nodesetval) {
-        for (int i = 0; i < nameNodesResult->nodesetval->nodeNr; ++i) {
-            xmlNodePtr node = nameNodesResult->nodesetval->nodeTab[i];
-
-            // 提取名称内容
-            xmlChar* content = xmlNodeGetContent(node);
-            if (content) {
-                std::string varName = reinterpret_cast<char*>(content);
-                // 过滤关键词
-                static const std::vector<std::string> keywords = {
-                        "int", "char", "void", "NULL", "errno", "sizeof", "defined"
-                };
-                bool isKeyword = std::find(keywords.begin(), keywords.end(), varName) != keywords.end();
-                if (!isKeyword &&
-                    varName.find("TINYDIR_STRING") == std::string::npos &&
-                    varName.find("_FUNC") == std::string::npos) {
-                    variables.push_back(varName);
-                }
-                xmlFree(content);
-            }
-        }
-    }
-    xmlXPathFreeObject(nameNodesResult);
-
-    // 清理
-    xmlXPathFreeContext(xpathCtx);
-    xmlFreeDoc(doc);
-    xmlCleanupParser();
-
-    // 去重并排序
-    std::sort(variables.begin(), variables.end());
-    variables.erase(std::unique(variables.begin(), variables.end()), variables.end());
-
-    return variables;
-
+    return stream.takeElements();
 }
 
-
-
-std::vector<std::pair<std::string, bool>> StaticAnalyzer::extractFunctionFromXML(const std::string& xml) {
-
-    // vector of {functionname. hasArguments}
-    std::vector<std::pair<std::string, bool>> functions = {};
-    // Parse the XML from memory
-    xmlDocPtr doc = xmlReadMemory(xml.c_str(), xml.length(), "noname.xml", NULL, XML_PARSE_NOBLANKS);
-    if (doc == NULL) {
-        std::cerr << "Error: unable to parse XML." << std::endl;
-        return functions;
-    }
-
-    // Create XPath context
-    xmlXPathContextPtr xpathCtx = xmlXPathNewContext(doc);
-    if (xpathCtx == NULL) {
-        std::cerr << "Error: unable to create new XPath context." << std::endl;
-        xmlFreeDoc(doc);
-        return functions;
-    }
-
-    // Register the 'src' namespace with the prefix 'src'
-    if (xmlXPathRegisterNs(xpathCtx, BAD_CAST "src", BAD_CAST "http://www.srcML.org/srcML/src") != 0) {
-        std::cerr << "Error: unable to register namespace." << std::endl;
-        xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
-        return functions;
-    }
-
-    //TODO: remove //src:macro//src:name need to be verified
-    const xmlChar* xpathExpr = BAD_CAST "//src:call/src:name" ;
-    xmlXPathObjectPtr nameNodesResult = xmlXPathEvalExpression(xpathExpr, xpathCtx);
-    if (nameNodesResult && nameNodesResult->nodesetval) {
-        int size = nameNodesResult->nodesetval->nodeNr;
-        for (int i = 0; i < size; ++i) {
-            xmlNodePtr node = nameNodesResult->nodesetval->nodeTab[i];
-
-            xmlChar* content = xmlNodeGetContent(node);
-            if (content) {
-                std::string funcName = (char*)content;
-                //remove whitespace
-                funcName.erase(std::remove_if(funcName.begin(), funcName.end(), ::isspace), funcName.end());
-
-                xmlNodePtr parent = node->parent;
-                bool hasArguments = false;
-
-                if (parent) {
-                    xmlNodePtr argList = parent->children;
-                    while (argList) {
-                        if (xmlStrcmp(argList->name, BAD_CAST "argument_list") == 0) {
-                            // check whether <argument_list> have <argument> in it
-                            xmlNodePtr arg = argList->children;
-                            while (arg) {
-                                if (xmlStrcmp(arg->name, BAD_CAST "argument") == 0) {
-                                    hasArguments = true;
-                                    break;
-                                }
-                                arg = arg->next;
-                            }
-                            break;
-                        }
-                        argList = argList->next;
-                    }
-                }
-
-                if (!funcName.empty()) {
-                    functions.push_back({funcName, hasArguments});
-                }
-                xmlFree(content);
-            }
-        }
-    }
-    if (nameNodesResult) {
-        xmlXPathFreeObject(nameNodesResult);
-    }
-
-    xmlXPathFreeContext(xpathCtx);
-    xmlFreeDoc(doc);
-    xmlCleanupParser();
-
-    return functions;
-}
-
-
-
-std::vector<std::string> StaticAnalyzer::extractFromCall(const std::string& expression) {
-    std::vector<std::string> vars;
-    std::string buffer;
-    bool inBrackets = false;
-
-    for (size_t i = 0; i < expression.length(); ++i) {
-        if (expression[i] == '(') {
-            inBrackets = true;
-        } else if (expression[i] == ')') {
-            if (!buffer.empty()) {
-                vars.push_back(buffer);
-                buffer.clear();
-            }
-            inBrackets = false;
-        } else if (inBrackets) {
-            if (std::isalnum(expression[i]) || expression[i] == '_') {
-                buffer += expression[i];
-            } else if (expression[i] == ',') {
-                // handle when const strings are optimized at preprocess, only leave blank space
-                vars.push_back(buffer);
-                buffer.clear();
-            } else if (expression[i] == ',' || std::isspace(expression[i])) {
-                if (!buffer.empty()) {
-                    vars.push_back(buffer);
-                    buffer.clear();
-                }
-            }
-        }
-    }
-
-    return vars;
-}
-
-
-std::pair<variableInfo, functionInfo> StaticAnalyzer::extractVariables(const std::string& expression,
-                                                          const std::string& type) {
-    std::vector<std::string> variables = {};
-    std::vector<std::pair<std::string, bool>>  functionCalls = {};
-    if (type == "decl" || type == "expr") {
-        std::string command = "echo \"" + expression + "\" | srcml --language=C++ --position  ";
-        std::string srcml_output = exec(command.c_str());
-        variables = extractVariablesFromXML(srcml_output);
-        std::cout << "variables: " ;
-        for (auto var : variables) {
-            std::cout << var << " ";
-        }
-        std::cout << std::endl;
-        functionCalls = extractFunctionFromXML(srcml_output);
-    } else if (type == "call") {
-        variables = extractFromCall(expression);
-        std::string command = "echo \"" + expression + "\" | srcml --language=C++ --position  ";
-        std::string srcml_output = exec(command.c_str());
-        functionCalls = extractFunctionFromXML(srcml_output);
-    } else if (type == "parameter") {
-        std::istringstream stream(expression);
-        std::string var;
-        while (stream >> var) {
-            variables.push_back(var);
-        }
-    }
-
-    return {variables, functionCalls};
-}
-
-
 // Function to execute a shell command and capture its output
 std::string StaticAnalyzer::exec(const char* cmd) {
     std::array<char, 128> buffer;
@@ -393,6 +109,24 @@ std::string StaticAnalyzer::exec(const char* cmd) {
 // Function to find start/end line and file name of a function
 std::tuple<std::string, int, int> StaticAnalyzer::getFunctionInfo(const std::string& binary,
                                                                   const std::string& function_name) {
+    std::unique_ptr<FunctionIndex>& index = functionIndexes[binary];
+    if (index == nullptr) {
+        index.reset(new FunctionIndex());
+        index->build(binary);
+    }
+    // binaries without DWARF fall back to nm and addr2line
+    if (!index->hasDebugInfo()) {
+        return getFunctionInfoFromBinutils(binary, function_name);
+    }
+    FunctionLocation location;
+    if (!index->lookup(function_name, location)) {
+        return {"", 0, 0};
+    }
+    return {location.file, location.startLine, location.endLine};
+}
+
+std::tuple<std::string, int, int> StaticAnalyzer::getFunctionInfoFromBinutils(const std::string& binary,
+                                                                              const std::string& function_name) {
     ////TODO: find out how to get the start and end line of a function
     //      that is not in the target binary, but in linked libraries
 
@@ -499,75 +233,10 @@ std::tuple<std::string, int, int> StaticAnalyzer::getFunctionInfo(const std::str
 }
 
 
-std::string StaticAnalyzer::preprocessCode(const std::string& code) {
-    // preprocess the output, remove comments and empty lines, as well as the const strings
-    // then make them in one line
-    std::string output;
-    std::istringstream stream(code);
-    std::string line;
-    while (std::getline(stream, line)) {
-        // Regex to match reinterpret_cast or static_cast or dynamic_cast or const_cast
-        // Pattern breakdown:
-        // (reinterpret_cast|static_cast|dynamic_cast|const_cast)      : Match the cast type
-        // \s*<\s*([^>]+)\s*>                                        : Match the template parameter inside <>
-        // \s*\(\s*([^()]+)\s*\)                                     : Match the expression inside ()
-        std::regex cast_regex(R"((reinterpret_cast|static_cast|dynamic_cast|const_cast)\s*<\s*([^>]+)\s*>\s*\(\s*([^()]+)\s*\))");
-
-        // Replace the entire cast expression with just the inner expression (third capture group)
-        line = std::regex_replace(line, cast_regex, "$3");
-
-        // 2. Remove C-style casts by replacing them with their inner expressions
-        // Pattern: (type) expression
-        // Replacement: expression
-        // This pattern handles types with pointers, references, namespaces, and templates
-        std::regex c_cast_regex(R"(\(\s*[a-zA-Z_:][a-zA-Z0-9_:<>\*\&\s]*\s*\)\s*([a-zA-Z_][a-zA-Z0-9_]*)\b)");
-        line = std::regex_replace(line, c_cast_regex, "$1");
-
-        // 3. Replace sizeof(expression) with expression
-        // Pattern: sizeof ( expression )
-        // Replacement: expression
-        std::regex sizeof_with_parentheses_regex(R"(sizeof\s*\(\s*([^()]+?)\s*\))");
-        line = std::regex_replace(line, sizeof_with_parentheses_regex, "$1");
-
-        // 4. Replace sizeof type with type
-        // Pattern: sizeof type
-        // Replacement: type
-        // This pattern handles types with namespaces and template parameters
-        std::regex sizeof_without_parentheses_regex(R"(sizeof\s+([a-zA-Z_:][a-zA-Z0-9_:<>]*))");
-        line = std::regex_replace(line, sizeof_without_parentheses_regex, "$1");
-
-        // Remove comment
-        size_t comment_pos = line.find("//");
-        if (comment_pos != std::string::npos) {
-            line = line.substr(0, comment_pos);
-        }
-
-        size_t comment_start = line.find("/*");
-        size_t comment_end = line.find("*/");
-        if (comment_start != std::string::npos && comment_end != std::string::npos) {
-            line = line.substr(0, comment_start) + line.substr(comment_end + 2);
-        }
-        // Remove empty lines
-        if (line.empty()) continue;
-        // Remove leading spaces
-        std::size_t start = line.find_first_not_of(" \t");
-        if (start != std::string::npos) { // Check if line is not just whitespace
-            std::size_t end = line.find_last_not_of(" \t");
-            line = line.substr(start, end - start + 1);
-        }
-
-        // Remove const strings between double quotes
-        size_t quote_start = line.find("\"");
-        size_t quote_end = line.find("\"", quote_start + 1);
-        while (quote_start != std::string::npos && quote_end != std::string::npos) {
-            line = line.substr(0, quote_start) + line.substr(quote_end + 1);
-            quote_start = line.find("\"");
-            quote_end = line.find("\"", quote_start + 1);
-        }
-
-        output += line + " ";
-    }
-    return output;
+std::string StaticAnalyzer::preprocessCode(std::string_view code) {
+    // preprocess the output, remove comments and empty lines, as well as the const strings,
+    // casts and sizeof, then make them in one line
+    return preprocessSource(code);
 }
 
 
@@ -576,12 +245,12 @@ void StaticAnalyzer::printTaintMap(const TaintMap& taintMap){
     for (const auto& [funcName, taints] : taintMap) {
         std::cout << "Function: " << funcName << std::endl;
         std::cout << "Tainted variables: ";
-        for (const auto& var : taints.first) {
+        for (const auto& var : variableNames(funcName, taints.variables)) {
             std::cout << var << " ";
         }
         std::cout << std::endl;
         std::cout << "Tainted parameters: ";
-        for (const auto& var : taints.second) {
+        for (const auto& var : paramSlotNames(taints.params)) {
             std::cout << var << ", ";
         }
         std::cout << "\n====="<< std::endl;
@@ -589,7 +258,386 @@ void StaticAnalyzer::printTaintMap(const TaintMap& taintMap){
     std::cout << "\n\n\n" << std::endl;
 }
 
-void StaticAnalyzer::backwardTaintAnalysis(const std::vector<CodeElement>& stmts,
+StaticAnalyzer::StaticAnalyzer() {
+    this->taintMemoHits = 0;
+    this->taintMemoMisses = 0;
+    this->taintStateReused = 0;
+}
+
+int StaticAnalyzer::getTaintStateReused() {
+    return this->taintStateReused;
+}
+
+static uint64_t definitionsHash(const std::map<std::string, std::vector<std::string>>& definitions, const std::string& name) {
+    auto it = definitions.find(name);
+    if (it == definitions.end()) {
+        return 0;
+    }
+    uint64_t hash = fnv1a(name.data(), name.size());
+    for (const auto& def : it->second) {
+        hash = fnv1a(def.data(), def.size() + 1, hash);
+    }
+    // 0 stands for no definitions
+    return hash == 0 ? 1 : hash;
+}
+
+uint64_t StaticAnalyzer::elementsHash(const std::string& function, const std::vector<CodeElement>& stmts) {
+    auto cached = this->elementHashes.find(function);
+    if (cached != this->elementHashes.end()) {
+        return cached->second;
+    }
+    uint64_t hash = fnv1a(function.data(), function.size());
+    // strings go in with their terminator and lists with their length, so no two statements hash alike by shifting
+    auto addString = [&](const std::string& value) {
+        hash = fnv1a(value.data(), value.size() + 1, hash);
+    };
+    auto addNames = [&](const variableInfo& names) {
+        uint64_t count = names.size();
+        hash = fnv1a(&count, sizeof(count), hash);
+        for (const auto& name : names) {
+            addString(name);
+        }
+    };
+    // the taint passes read every field of a statement, so all of them decide whether a memo entry still holds
+    for (const auto& stmt : stmts) {
+        addString(stmt.type);
+        addString(stmt.content);
+        addNames(stmt.variables);
+        uint64_t calls = stmt.calls.size();
+        hash = fnv1a(&calls, sizeof(calls), hash);
+        for (const auto& [callee, hasArguments] : stmt.calls) {
+            addString(callee);
+            hash = fnv1a(&hasArguments, sizeof(hasArguments), hash);
+        }
+        addString(stmt.callee);
+        uint64_t arguments = stmt.arguments.size();
+        hash = fnv1a(&arguments, sizeof(arguments), hash);
+        for (const auto& argument : stmt.arguments) {
+            addNames(argument);
+        }
+    }
+    this->elementHashes[function] = hash;
+    return hash;
+}
+
+void StaticAnalyzer::forgetFunction(const std::string& function) {
+    this->functionIRs.erase(function);
+    this->elementHashes.erase(function);
+    // entries of this run are replayed without checks, so the ones of the old statements have to go
+    for (auto it = this->taintMemo.begin(); it != this->taintMemo.end(); ) {
+        it = it->first.function == function ? this->taintMemo.erase(it) : std::next(it);
+    }
+}
+
+bool StaticAnalyzer::isMemoCurrent(TaintMemoEntry& entry, const std::string& function, const std::vector<CodeElement>& stmts,
+                                   const std::map<std::string, std::vector<std::string>>& definitions,
+                                   const std::vector<Node*>& nodesInGraph) {
+    // entries of this run always are, an entry of an earlier run is checked once
+    if (!entry.fromState) {
+        return true;
+    }
+    if (entry.elementsHash != elementsHash(function, stmts)) {
+        return false;
+    }
+    for (const auto& [name, hash] : entry.definitionsUsed) {
+        if (definitionsHash(definitions, name) != hash) {
+            return false;
+        }
+    }
+    for (const auto& [name, inGraph] : entry.graphNamesUsed) {
+        bool found = std::any_of(nodesInGraph.begin(), nodesInGraph.end(), [&](Node* node) { return node->get_name() == name; });
+        if (found != inGraph) {
+            return false;
+        }
+    }
+    entry.fromState = false;
+    this->taintStateReused++;
+    return true;
+}
+
+static nlohmann::json taintSetToJson(const TaintSet& set) {
+    return set.ids();
+}
+
+// the largest parameter slot, a saved slot beyond it can only come from a damaged file
+static uint32_t checkedSlot(uint32_t slot) {
+    if (slot > returnSlot(MAX_PARAM_INDEX)) {
+        throw std::out_of_range("parameter slot " + std::to_string(slot));
+    }
+    return slot;
+}
+
+// variable ids are mapped through remap, without one the ids are parameter slots
+static TaintSet taintSetFromJson(const nlohmann::json& ids, const std::vector<uint32_t>* remap) {
+    TaintSet set;
+    for (uint32_t id : ids.get<std::vector<uint32_t>>()) {
+        if (remap == NULL) {
+            set.insert(checkedSlot(id));
+        } else if (id < remap->size()) {
+            set.insert((*remap)[id]);
+        }
+    }
+    return set;
+}
+
+bool StaticAnalyzer::saveTaintState(const std::string& path) {
+    nlohmann::json state;
+    state["version"] = TAINT_STATE_VERSION;
+    state["analyzerVersion"] = FUNCTION_CACHE_ANALYZER_VERSION;
+    nlohmann::json symbols = nlohmann::json::object();
+    for (const auto& [function, table] : this->symbolTables) {
+        nlohmann::json names = nlohmann::json::array();
+        for (uint32_t id = 0; id < table.size(); id++) {
+            names.push_back(table.name(id));
+        }
+        symbols[function] = names;
+    }
+    state["symbols"] = symbols;
+    nlohmann::json memo = nlohmann::json::array();
+    for (const auto& [key, entry] : this->taintMemo) {
+        memo.push_back({
+            {"function", key.function}, {"previous", key.previousFunction},
+            {"forward", key.isForward}, {"forceTrack", key.forceTrack},
+            {"inputVariables", taintSetToJson(key.input.variables)}, {"inputParams", taintSetToJson(key.input.params)},
+            {"previousParams", taintSetToJson(key.previousParams)},
+            {"outputVariables", taintSetToJson(entry.output.variables)}, {"outputParams", taintSetToJson(entry.output.params)},
+            {"calleeParams", entry.calleeParams}, {"pushes", entry.pushes},
+            {"elementsHash", entry.elementsHash}, {"definitionsUsed", entry.definitionsUsed},
+            {"graphNamesUsed", entry.graphNamesUsed}
+        });
+    }
+    state["memo"] = memo;
+
+    // the client and the daemon may save the same state, each writes its own temporary file
+    AtomicFileWriter file;
+    if (!file.open(path, false)) {
+        std::cerr << "Error: unable to open file " << file.temporaryPath() << std::endl;
+        return false;
+    }
+    file.stream() << state.dump();
+    if (!file.commit()) {
+        std::cerr << "Error: unable to write taint state " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool StaticAnalyzer::loadTaintState(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cout << "No taint state at " << path << ", analyzing from scratch" << std::endl;
+        return false;
+    }
+    nlohmann::json state = nlohmann::json::parse(file, nullptr, false);
+    if (state.is_discarded() || !state.is_object()) {
+        std::cerr << "Error: ignoring damaged taint state " << path << std::endl;
+        return false;
+    }
+    // a truncated or hand-edited file fails a type or range check somewhere below (at() and get<> throw),
+    // it is then dropped as a whole and nothing of it reaches the memo
+    std::map<std::string, std::vector<std::string>> symbols;
+    std::vector<std::pair<TaintMemoKey, TaintMemoEntry>> entries;
+    try {
+        if (state.at("version").get<int>() != TAINT_STATE_VERSION ||
+            state.at("analyzerVersion").get<int>() != FUNCTION_CACHE_ANALYZER_VERSION) {
+            std::cerr << "Error: ignoring taint state " << path << " of another analyzer version" << std::endl;
+            return false;
+        }
+        symbols = state.at("symbols").get<std::map<std::string, std::vector<std::string>>>();
+        // the saved ids are mapped onto the symbol tables of this analyzer, which may already hold names
+        std::map<std::string, std::vector<uint32_t>> remaps;
+        for (const auto& [function, names] : symbols) {
+            SymbolTable& table = symbolTable(function);
+            std::vector<uint32_t>& remap = remaps[function];
+            for (const auto& name : names) {
+                remap.push_back(table.intern(name));
+            }
+        }
+        static const std::vector<uint32_t> noNames;
+        for (const auto& saved : state.at("memo")) {
+            std::string function = saved.at("function").get<std::string>();
+            auto remap = remaps.find(function);
+            const std::vector<uint32_t>* variables = remap == remaps.end() ? &noNames : &remap->second;
+            TaintMemoKey key{function, saved.at("previous").get<std::string>(), saved.at("forward").get<bool>(),
+                             saved.at("forceTrack").get<bool>(),
+                             {taintSetFromJson(saved.at("inputVariables"), variables), taintSetFromJson(saved.at("inputParams"), NULL)},
+                             taintSetFromJson(saved.at("previousParams"), NULL)};
+            TaintMemoEntry entry;
+            entry.output = {taintSetFromJson(saved.at("outputVariables"), variables), taintSetFromJson(saved.at("outputParams"), NULL)};
+            entry.calleeParams = saved.at("calleeParams").get<std::vector<std::pair<std::string, uint32_t>>>();
+            for (const auto& calleeParam : entry.calleeParams) {
+                checkedSlot(calleeParam.second);
+            }
+            entry.pushes = saved.at("pushes").get<std::vector<std::pair<std::string, bool>>>();
+            entry.elementsHash = saved.at("elementsHash").get<uint64_t>();
+            entry.definitionsUsed = saved.at("definitionsUsed").get<std::vector<std::pair<std::string, uint64_t>>>();
+            entry.graphNamesUsed = saved.at("graphNamesUsed").get<std::vector<std::pair<std::string, bool>>>();
+            entry.fromState = true;
+            entries.emplace_back(std::move(key), std::move(entry));
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "Error: ignoring damaged taint state " << path << ": " << error.what() << std::endl;
+        return false;
+    }
+    int loaded = 0;
+    for (auto& [key, entry] : entries) {
+        // an entry of this run is newer than the saved one
+        if (this->taintMemo.emplace(std::move(key), std::move(entry)).second) {
+            loaded++;
+        }
+    }
+    std::cout << "Loaded " << loaded << " taint results from " << path << std::endl;
+    return true;
+}
+
+int StaticAnalyzer::getTaintMemoHits() {
+    return this->taintMemoHits;
+}
+
+int StaticAnalyzer::getTaintMemoMisses() {
+    return this->taintMemoMisses;
+}
+
+bool TaintMemoKey::operator==(const TaintMemoKey& other) const {
+    return this->isForward == other.isForward && this->forceTrack == other.forceTrack &&
+           this->function == other.function && this->previousFunction == other.previousFunction &&
+           this->input == other.input && this->previousParams == other.previousParams;
+}
+
+size_t TaintMemoKeyHash::operator()(const TaintMemoKey& key) const {
+    // canonical over the sets, so equal taint hashes equally however the bitsets were grown
+    uint64_t hash = std::hash<std::string>()(key.function) * 31 + std::hash<std::string>()(key.previousFunction);
+    hash = hash * 4 + key.isForward * 2 + key.forceTrack;
+    hash = key.input.variables.hash(hash);
+    hash = key.input.params.hash(hash);
+    return key.previousParams.hash(hash);
+}
+
+void StaticAnalyzer::taintCalleeParam(TaintMap& taintMap, const std::string& callee, uint32_t slot) {
+    taintMap[callee].params.insert(slot);
+    this->calleeParams.push_back({callee, slot});
+}
+
+SymbolTable& StaticAnalyzer::symbolTable(const std::string& function) {
+    return this->symbolTables[function];
+}
+
+std::set<std::string> StaticAnalyzer::variableNames(const std::string& function, const TaintSet& variables) {
+    std::set<std::string> names;
+    const SymbolTable& symbols = symbolTable(function);
+    for (uint32_t id : variables.ids()) {
+        names.insert(symbols.name(id));
+    }
+    return names;
+}
+
+void StaticAnalyzer::addTaint(TaintMap& taintMap, const std::string& function, const std::set<std::string>& variables,
+                              const std::set<std::string>& params) {
+    FunctionTaint& taint = taintMap[function];
+    SymbolTable& symbols = symbolTable(function);
+    for (const auto& var : variables) {
+        taint.variables.insert(symbols.intern(var));
+    }
+    for (const auto& param : params) {
+        int64_t slot = paramSlot(param);
+        if (slot < 0) {
+            std::cerr << "Error: " << param << " of " << function << " is not a parameter (#n, $n or $*, n <= " << MAX_PARAM_INDEX << ")" << std::endl;
+            continue;
+        }
+        taint.params.insert(slot);
+    }
+}
+
+// statement types of the parser, as the taint passes tell them apart
+static const std::pair<const char*, ClassificationType> statementKinds[] = {
+        {"decl", VARIABLE_DECLARATION},
+        {"expr", EXPRESSION},
+        {"call", FUNCTION_CALL},
+        {"return", RETURN_STATEMENT},
+        {"parameter", PARAMETER_DECLARATION},
+};
+
+static ClassificationType statementKind(const std::string& type) {
+    for (const auto& [name, kind] : statementKinds) {
+        if (type == name) {
+            return kind;
+        }
+    }
+    return OTHER_TYPE;
+}
+
+static const char* statementTypeName(ClassificationType kind) {
+    for (const auto& [name, statementKind] : statementKinds) {
+        if (kind == statementKind) {
+            return name;
+        }
+    }
+    return "other";
+}
+
+IdRange FunctionIR::variablesOf(const Statement& stmt) const {
+    return {this->variables.data() + stmt.variablesBegin, this->variables.data() + stmt.variablesEnd};
+}
+
+IdRange FunctionIR::argument(const Statement& stmt, size_t index) const {
+    const auto& [begin, end] = this->arguments[stmt.argumentsBegin + index];
+    return {this->variables.data() + begin, this->variables.data() + end};
+}
+
+size_t FunctionIR::argumentCount(const Statement& stmt) const {
+    return stmt.argumentsEnd - stmt.argumentsBegin;
+}
+
+std::string_view FunctionIR::textOf(const Statement& stmt) const {
+    return std::string_view(this->text).substr(stmt.textBegin, stmt.textEnd - stmt.textBegin);
+}
+
+const FunctionIR& StaticAnalyzer::functionIR(const std::string& function, const std::vector<CodeElement>& stmts) {
+    // the statements of a function do not change during the life of the analyzer, like its elements hash
+    auto lowered = this->functionIRs.find(function);
+    if (lowered != this->functionIRs.end()) {
+        return lowered->second;
+    }
+    FunctionIR& ir = this->functionIRs[function];
+    SymbolTable& symbols = symbolTable(function);
+    ir.statements.reserve(stmts.size());
+    for (const auto& element : stmts) {
+        Statement stmt;
+        stmt.kind = statementKind(element.type);
+        stmt.callee = this->functionNames.intern(element.callee);
+        stmt.variablesBegin = ir.variables.size();
+        for (const auto& var : element.variables) {
+            ir.variables.push_back(symbols.intern(var));
+        }
+        stmt.variablesEnd = ir.variables.size();
+        stmt.argumentsBegin = ir.arguments.size();
+        for (const auto& argument : element.arguments) {
+            uint32_t begin = ir.variables.size();
+            for (const auto& var : argument) {
+                ir.variables.push_back(symbols.intern(var));
+            }
+            ir.arguments.push_back({begin, (uint32_t)ir.variables.size()});
+        }
+        stmt.argumentsEnd = ir.arguments.size();
+        stmt.callsBegin = ir.calls.size();
+        for (const auto& call : element.calls) {
+            ir.calls.push_back({this->functionNames.intern(call.first), call.second});
+        }
+        stmt.callsEnd = ir.calls.size();
+        stmt.textBegin = ir.text.size();
+        ir.text.append(element.content);
+        stmt.textEnd = ir.text.size();
+        ir.statements.push_back(stmt);
+    }
+    // constants are never tainted, decided once per name instead of at every use
+    ir.constants.resize(symbols.size());
+    for (uint32_t id = 0; id < symbols.size(); id++) {
+        ir.constants[id] = isdigit(symbols.name(id));
+    }
+    return ir;
+}
+
+void StaticAnalyzer::backwardTaintAnalysis(const FunctionIR& ir,
                                            TaintMap& taintMap,
                                            std::stack<std::pair<std::string, bool>>& functionStack,
                                            std::map<std::string, std::vector<std::string>> definitions,
@@ -597,31 +645,38 @@ void StaticAnalyzer::backwardTaintAnalysis(const std::vector<CodeElement>& stmts
                                            std::string currentFunction,
                                            std::string previousFunction,
                                            bool isForward,
-                                           std::set<std::string>& taintedVariables,
-                                           std::set<std::string>& taintedVariablesPrev,
+                                           TaintSet& taintedVariables,
+                                           const TaintSet& taintedVariablesPrev,
                                            bool forceTrack,
                                            bool startToTrack){
 
+    const SymbolTable& symbols = symbolTable(currentFunction);
+    auto isTainted = [&](uint32_t id) {
+        return taintedVariables.contains(id);
+    };
+    int64_t previousCallee = this->functionNames.find(previousFunction);
     int parameterIndex = 0;
-    for (auto it = stmts.rbegin(); it != stmts.rend(); it++) {
-        CodeElement stmt = *it;
-        std::cout << "backward visiting stmt: " << stmt.content << " of type: " << stmt.type << std::endl;
+    for (auto it = ir.statements.rbegin(); it != ir.statements.rend(); it++) {
+        const Statement& stmt = *it;
+        std::cout << "backward visiting stmt: " << ir.textOf(stmt) << " of type: " << statementTypeName(stmt.kind) << std::endl;
         // start to track the tainted variables when the previous function is called
 //        std::cout << "Current tainted paras: ";
-//        for (const auto& var : taintMap[currentFunction].second) {
+//        for (const auto& var : paramSlotNames(taintMap[currentFunction].params)) {
 //            std::cout << var << " ";
 //        }
 //        std::cout << std::endl;
 
         if(!forceTrack){
-            if (stmt.type == "call" && startToTrack == false) {
-                std::string funcName = stmt.content.substr(0, stmt.content.find("("));
-                if (funcName == previousFunction) {
+            if (stmt.kind == FUNCTION_CALL && startToTrack == false) {
+                if (stmt.callee == previousCallee) {
                     startToTrack = true;
                 }
                 // visit definition map, if the function is in the definition map
                 // then start to track the tainted variables
+                const std::string& funcName = this->functionNames.name(stmt.callee);
+                this->definitionsUsed.push_back({funcName, 0});
                 if (definitions.find(funcName) != definitions.end()) {
+                    this->definitionsUsed.back().second = definitionsHash(definitions, funcName);
                     for (const auto &def: definitions[funcName]) {
                         if (def == previousFunction) {
                             startToTrack = true;
@@ -634,82 +689,77 @@ void StaticAnalyzer::backwardTaintAnalysis(const std::vector<CodeElement>& stmts
             }
         }
 
-        // std::cout << "stmt: " << stmt.content << " type: " << stmt.type << std::endl;
-        variableInfo variables = {};
-        functionInfo functionCalls = {};
-        std::tie(variables, functionCalls) = extractVariables(stmt.content, stmt.type);
-        if (stmt.type == "decl")
+        IdRange variables = ir.variablesOf(stmt);
+        if (stmt.kind == VARIABLE_DECLARATION)
         {
             // then put the variable on both left and right side into the tainted variable set
             // but const values like int a = 1, should not be put into the tainted variable set
-            for (const auto& var : variables) {
-                if (taintedVariables.find(var) != taintedVariables.end()) {
+            for (uint32_t var : variables) {
+                if (isTainted(var)) {
                     // if the variable is already tainted, then put all the variables in the declaration into the tainted variable set
-                    for (const auto& var : variables) {
+                    for (uint32_t var : variables) {
                         // if the variable is a const value, then do not put it into the tainted variable set
-                        cout << "Variable: " << var << " is digit: " << isdigit(var) << endl;
-                        if (isdigit(var)) {
+                        cout << "Variable: " << symbols.name(var) << " is digit: " << ir.constants[var] << endl;
+                        if (ir.constants[var]) {
                             continue;
                         }
                         taintedVariables.insert(var);
                     }
                 }
             }
-        }else if (stmt.type == "expr") {
+        }else if (stmt.kind == EXPRESSION) {
             // if the expression contains any tainted variable, then put all the variables in the expression into the tainted variable set
-            for (const auto& var : variables) {
-                if (taintedVariables.find(var) != taintedVariables.end()) {
-                    for (const auto& var : variables) {
-                        if (isdigit(var)) {
+            for (uint32_t var : variables) {
+                if (isTainted(var)) {
+                    for (uint32_t var : variables) {
+                        if (ir.constants[var]) {
                             continue;
                         }
                         taintedVariables.insert(var);
                     }
                 }
             }
-        }else if (stmt.type == "call") {
+        }else if (stmt.kind == FUNCTION_CALL) {
             // if it is the previous function, extract the tainted variables from the map
-            if (stmt.content.substr(0, stmt.content.find("(")) == previousFunction) {
-                for (const auto& var : taintedVariablesPrev) {
-                    std::cout << "visiting parameter: " << var << std::endl;
-                    // the var is like #1, #2, #13, etc.
-                    // we need to find the corresponding parameter in the function call
-                    if (var[0] == '#') {
-                        int varIndex = std::stoi(var.substr(1));
-                        // print out all of the variables in the function call
-                        for (const auto& var : variables) {
-                            std::cout << "Parameter: " << var << std::endl;
-                        }
-                        std::string arg = variables[varIndex];
-                        if (isdigit(arg)) {
+            if (stmt.callee == previousCallee) {
+                for (uint32_t slot : taintedVariablesPrev.ids()) {
+                    std::cout << "visiting parameter: " << paramSlotName(slot) << std::endl;
+                    // the slot is like #1, #2, #13, etc.
+                    // we need to find the corresponding argument of the function call
+                    if (isArgumentSlot(slot)) {
+                        size_t varIndex = slotIndex(slot);
+                        if (varIndex >= ir.argumentCount(stmt)) {
                             continue;
                         }
-                        taintedVariables.insert(arg);
-                    }else if (var[0] == '$') {
-                        //TODO: if the variable is a return value, then put all the variables in the function call into the tainted variable set
-                        for (const auto& var : variables) {
-                            taintedVariables.insert(var);
-                            if (isdigit(var)) {
+                        for (uint32_t arg : ir.argument(stmt, varIndex)) {
+                            std::cout << "Parameter: " << symbols.name(arg) << std::endl;
+                            if (ir.constants[arg]) {
                                 continue;
                             }
+                            taintedVariables.insert(arg);
+                        }
+                    }else {
+                        //TODO: if the variable is a return value, then put all the variables in the function call into the tainted variable set
+                        for (uint32_t var : variables) {
+                            taintedVariables.insert(var);
                         }
                     }
 
                 }
             }else{
                 // if it is not the previous function, then put all the variables in the function call into the tainted variable set
-                for (const auto& var : variables) {
-                    if (isdigit(var)) {
+                for (uint32_t var : variables) {
+                    if (ir.constants[var]) {
                         continue;
                     }
                     taintedVariables.insert(var);
                 }
             }
 
-        }else if (stmt.type == "return") {
-            if (taintMap[currentFunction].second.find("$*") != taintMap[currentFunction].second.end()) {
-                for (const auto &var: variables) {
-                    if (isdigit(var)) {
+        }else if (stmt.kind == RETURN_STATEMENT) {
+            if (taintMap[currentFunction].params.contains(ALL_RETURNS_SLOT)) {
+                for (uint32_t var : variables) {
+                    if (ir.constants[var]) {
                         continue;
                     }
                     taintedVariables.insert(var);
@@ -717,38 +767,34 @@ void StaticAnalyzer::backwardTaintAnalysis(const std::vector<CodeElement>& stmts
             }
 
             int index = 0;
-            for (const auto& var : variables) {
-                if (taintedVariables.find(var) != taintedVariables.end()) {
-                    std::string varIndex = "$" + std::to_string(index);
-                    taintMap[currentFunction].second.insert(varIndex);
+            for (uint32_t var : variables) {
+                if (isTainted(var)) {
+                    taintMap[currentFunction].params.insert(returnSlot(index));
                 }
                 index++;
             }
 
-        }else if (stmt.type == "parameter") {
+        }else if (stmt.kind == PARAMETER_DECLARATION) {
             // if the parameter contains any tainted variable,
             // then put all the variables in the parameter into the tainted variable set
-            for (const auto& var : variables) {
-                std::cout << "Parameter: " << var << std::endl;
-                if (taintedVariables.find(var) != taintedVariables.end()) {
-                    std::string varIndex = "#" + std::to_string(parameterIndex);
-                    taintMap[currentFunction].second.insert(varIndex);
-                    std::cout << "Tainted parameter: " << var << " index: " << varIndex << std::endl;
+            for (uint32_t var : variables) {
+                std::cout << "Parameter: " << symbols.name(var) << std::endl;
+                if (isTainted(var)) {
+                    taintMap[currentFunction].params.insert(argumentSlot(parameterIndex));
+                    std::cout << "Tainted parameter: " << symbols.name(var) << " index: #" << parameterIndex << std::endl;
                 }
                 parameterIndex++;
             }
 
         }
     }
-    for (const auto& var : taintedVariables) {
-        taintMap[currentFunction].first.insert(var);
-    }
+    taintMap[currentFunction].variables.unionWith(taintedVariables);
 
 }
 
 
 
-void StaticAnalyzer::forwardTaintAnalysis(const std::vector<CodeElement>& stmts,
+void StaticAnalyzer::forwardTaintAnalysis(const FunctionIR& ir,
                           TaintMap& taintMap,
                           std::stack<std::pair<std::string, bool>>& functionStack,
                           std::map<std::string, std::vector<std::string>> definitions,
@@ -756,20 +802,23 @@ void StaticAnalyzer::forwardTaintAnalysis(const std::vector<CodeElement>& stmts,
                           std::string currentFunction,
                           std::string previousFunction,
                           bool isForward,
-                          std::set<std::string>& taintedVariables,
-                          std::set<std::string>& taintedVariablesPrev,
+                          TaintSet& taintedVariables,
+                          const TaintSet& taintedVariablesPrev,
                           bool forceTrack,
                           bool startToTrack){
 
-    vector<string> parameters = {};
-    for (auto it = stmts.begin(); it != stmts.end(); ++it) {
-        CodeElement stmt = *it;
-        std::cout << "forward visiting stmt: " << stmt.content << " of type: " << stmt.type << std::endl;
+    const SymbolTable& symbols = symbolTable(currentFunction);
+    auto isTainted = [&](uint32_t id) {
+        return taintedVariables.contains(id);
+    };
+    int64_t previousCallee = this->functionNames.find(previousFunction);
+    int parameterCount = 0;
+    for (const Statement& stmt : ir.statements) {
+        std::cout << "forward visiting stmt: " << ir.textOf(stmt) << " of type: " << statementTypeName(stmt.kind) << std::endl;
 
         // start to track the tainted variables when the previous function is called
-        if (stmt.type == "call" && startToTrack == true) {
-            std::string funcName = stmt.content.substr(0, stmt.content.find("("));
-            if (funcName == previousFunction) {
+        if (stmt.kind == FUNCTION_CALL && startToTrack == true) {
+            if (stmt.callee == previousCallee) {
                 startToTrack = false;
             }
         }
@@ -778,59 +827,52 @@ void StaticAnalyzer::forwardTaintAnalysis(const std::vector<CodeElement>& stmts,
         }
 
 
-        // std::cout << "stmt: " << stmt.content << " type: " << stmt.type << std::endl;
-        variableInfo variables = {};
-        functionInfo functionCalls = {};
+        IdRange variables = ir.variablesOf(stmt);
 
-        std::tie(variables, functionCalls) = extractVariables(stmt.content, stmt.type);
-
-        if (stmt.type == "decl"){
+        if (stmt.kind == VARIABLE_DECLARATION){
 
             // then put the variable on both left and right side into the tainted variable set
             // but const values like int a = 1, should not be put into the tainted variable set
-            for (const auto& var : variables) {
+            for (uint32_t var : variables) {
 
-                if (taintedVariables.find(var) != taintedVariables.end()) {
+                if (isTainted(var)) {
                     // if the variable is already tainted, then put all the variables in the declaration into the tainted variable set
-                    for (const auto& var : variables) {
+                    for (uint32_t var : variables) {
                         // if the variable is a const value, then do not put it into the tainted variable set
-                        if (isdigit(var)) {
+                        if (ir.constants[var]) {
                             continue;
                         }
                         taintedVariables.insert(var);
-                        for (const auto&functionCall : functionCalls) {
+                        for (uint32_t c = stmt.callsBegin; c < stmt.callsEnd; c++) {
                             // if the functioncall doesn't have any arguments, isNextFunctionForward is false
-                            bool hasArguments = functionCall.second;
-                            std::string functionName = functionCall.first;
+                            bool hasArguments = ir.calls[c].hasArguments;
+                            const std::string& functionName = this->functionNames.name(ir.calls[c].callee);
                             std::cout << "Pushing function: " << functionName << " with hasArguments: " << hasArguments << std::endl;
                             functionStack.push({functionName, hasArguments});
                             if (!hasArguments){
                                 // taint all of the return value of the function call
-                                std::string returnValue = "$*";
-                                taintMap[functionName].second.insert(returnValue);
+                                taintCalleeParam(taintMap, functionName, ALL_RETURNS_SLOT);
                             }
                         }
-                        //std::cout << "Added Tainted variable: " << var << std::endl;
                     }
                 }
             }
-        }else if (stmt.type == "expr") {
+        }else if (stmt.kind == EXPRESSION) {
             // if the expression contains any tainted variable, then put all the variables in the expression into the tainted variable set
-            for (const auto& var : variables) {
-                if (taintedVariables.find(var) != taintedVariables.end()) {
-                    for (const auto& var : variables) {
-                        if (isdigit(var)) {
+            for (uint32_t var : variables) {
+                if (isTainted(var)) {
+                    for (uint32_t var : variables) {
+                        if (ir.constants[var]) {
                             continue;
                         }
                         taintedVariables.insert(var);
-                        //std::cout << "Added Tainted variable: " << var << std::endl;
                     }
                 }
             }
-        }else if (stmt.type == "call") {
+        }else if (stmt.kind == FUNCTION_CALL) {
             // if the function call contains any tainted variable,
             // then put all the args in the function call into the tainted variable set
-            std::string calledfuncName = stmt.content.substr(0, stmt.content.find("("));
+            const std::string& calledfuncName = this->functionNames.name(stmt.callee);
 
             // if the function is not in the nodesInGraph, then skip it
             bool isFunctionInGraph = false;
@@ -840,16 +882,19 @@ void StaticAnalyzer::forwardTaintAnalysis(const std::vector<CodeElement>& stmts,
                     break;
                 }
             }
+            this->graphNamesUsed.push_back({calledfuncName, isFunctionInGraph});
             if (isFunctionInGraph == false) {
                 continue;
             }
 
             // if it is the graph, keep track of the function call
-            std::vector<std::string> arguments = extractFromCall(stmt.content);
             std::cout << "Function call: " << calledfuncName
                       << " arguments: ";
-            for (const auto& arg : arguments) {
-                std::cout << arg << " ";
+            for (size_t index = 0; index < ir.argumentCount(stmt); index++) {
+                for (uint32_t arg : ir.argument(stmt, index)) {
+                    std::cout << symbols.name(arg) << " ";
+                }
+                std::cout << "| ";
             }
             std::cout << std::endl;
 
@@ -857,52 +902,40 @@ void StaticAnalyzer::forwardTaintAnalysis(const std::vector<CodeElement>& stmts,
             //print current function's tainted variables
             std::cout << "Current function: " << currentFunction << std::endl;
             std::cout << "Tainted variables: ";
-            for (const auto& var : taintedVariables) {
+            for (const auto& var : variableNames(currentFunction, taintedVariables)) {
                 std::cout << var << " ";
             }
             std::cout << std::endl;
 
-            int index = 0;
-            for (const auto& arg : arguments) {
-                if (taintedVariables.find(arg) != taintedVariables.end()) {
-                    std::string varIndex = "#" + std::to_string(index);
-                    taintMap[calledfuncName].second.insert(varIndex);
+            for (size_t index = 0; index < ir.argumentCount(stmt); index++) {
+                IdRange argument = ir.argument(stmt, index);
+                if (std::any_of(argument.begin(), argument.end(), isTainted)) {
+                    taintCalleeParam(taintMap, calledfuncName, argumentSlot(index));
                     bool isNextFunctionForward = true;
                     std::cout << "Pushing function: " << calledfuncName << " with hasArguments: " << isNextFunctionForward << std::endl;
                     functionStack.push({calledfuncName, isNextFunctionForward});
                     break;
                 }
-                index++;
-            }
-
-        }else if (stmt.type == "return") {
-        }else if (stmt.type == "parameter") {
-
-            vector<int> taintedParaIndex = {};
-            for (const auto& taintIndex : taintMap[currentFunction].second) {
-                int index = std::stoi(taintIndex.substr(1));
-                taintedParaIndex.push_back(index);
             }
 
+        }else if (stmt.kind == RETURN_STATEMENT) {
+        }else if (stmt.kind == PARAMETER_DECLARATION) {
 
-            for (const auto& var : variables) {
-                parameters.push_back(var);
-                int parameterIndex = parameters.size() - 1;
-                if (std::find(taintedParaIndex.begin(), taintedParaIndex.end(), parameterIndex) != taintedParaIndex.end()) {
-                    if (isdigit(var)) {
+            const TaintSet& taintedParams = taintMap[currentFunction].params;
+            for (uint32_t var : variables) {
+                int parameterIndex = parameterCount++;
+                if (taintedParams.contains(argumentSlot(parameterIndex))) {
+                    if (ir.constants[var]) {
                         continue;
                     }
                     taintedVariables.insert(var);
-                    //std::cout << "Added Tainted variable: " << var << std::endl;
                 }
             }
 
 
         }
     }
-    for (const auto& var : taintedVariables) {
-        taintMap[currentFunction].first.insert(var);
-    }
+    taintMap[currentFunction].variables.unionWith(taintedVariables);
 
 }
 
@@ -920,25 +953,58 @@ void StaticAnalyzer::TaintAnalysis(const std::vector<CodeElement>& stmts,
                                    bool isForward,
                                    bool forceTrack) {
     bool startToTrack = isForward ? true : false;
-    std::set<std::string> taintedVariables;
-    std::set<std::string> taintedVariablesPrev;
-    if (taintMap.find(currentFunction) == taintMap.end()) {
-        taintMap[currentFunction] = std::pair<std::set<std::string>, std::set<std::string>>();
-    }else{
-        taintedVariables = taintMap[currentFunction].first;
-    }
+    TaintSet taintedVariables = taintMap[currentFunction].variables;
 
     std::cout << "Current function: " << currentFunction << std::endl;
     std::cout << "Previous function: " << previousFunction << std::endl;
     std::cout << "isForward: " << isForward << std::endl;
-    taintedVariablesPrev = taintMap[previousFunction].second;
-
+    TaintSet taintedVariablesPrev = taintMap[previousFunction].params;
+
+    // the same function reached with the same taint gives the same result, replay it
+    TaintMemoKey key{currentFunction, previousFunction, isForward, forceTrack, taintMap[currentFunction], taintedVariablesPrev};
+    auto memo = this->taintMemo.find(key);
+    if (memo != this->taintMemo.end() && isMemoCurrent(memo->second, currentFunction, stmts, definitions, nodesInGraph)) {
+        this->taintMemoHits++;
+        std::cout << "Taint memo hit for " << currentFunction << std::endl;
+        taintMap[currentFunction].variables.unionWith(memo->second.output.variables);
+        taintMap[currentFunction].params.unionWith(memo->second.output.params);
+        for (const auto& [callee, slot] : memo->second.calleeParams) {
+            taintMap[callee].params.insert(slot);
+        }
+        for (const auto& push : memo->second.pushes) {
+            functionStack.push(push);
+        }
+        return;
+    }
+    this->taintMemoMisses++;
+    this->calleeParams.clear();
+    this->definitionsUsed.clear();
+    this->graphNamesUsed.clear();
+    size_t stackSize = functionStack.size();
 
+    const FunctionIR& ir = functionIR(currentFunction, stmts);
     if (isForward == false){
-        backwardTaintAnalysis(stmts, taintMap, functionStack, definitions, nodesInGraph, currentFunction, previousFunction, isForward, taintedVariables, taintedVariablesPrev, forceTrack, startToTrack);
+        backwardTaintAnalysis(ir, taintMap, functionStack, definitions, nodesInGraph, currentFunction, previousFunction, isForward, taintedVariables, taintedVariablesPrev, forceTrack, startToTrack);
     }else if(isForward == true) {
-        forwardTaintAnalysis(stmts, taintMap, functionStack, definitions, nodesInGraph, currentFunction, previousFunction, isForward, taintedVariables, taintedVariablesPrev, forceTrack, startToTrack);
+        forwardTaintAnalysis(ir, taintMap, functionStack, definitions, nodesInGraph, currentFunction, previousFunction, isForward, taintedVariables, taintedVariablesPrev, forceTrack, startToTrack);
+    }
+
+    TaintMemoEntry entry;
+    entry.output = taintMap[currentFunction];
+    entry.calleeParams = std::move(this->calleeParams);
+    entry.elementsHash = elementsHash(currentFunction, stmts);
+    entry.definitionsUsed = std::move(this->definitionsUsed);
+    entry.graphNamesUsed = std::move(this->graphNamesUsed);
+    entry.fromState = false;
+    // the stack only grows during the analysis, take the new pushes off and put them back
+    for (; functionStack.size() > stackSize; functionStack.pop()) {
+        entry.pushes.push_back(functionStack.top());
+    }
+    std::reverse(entry.pushes.begin(), entry.pushes.end());
+    for (const auto& push : entry.pushes) {
+        functionStack.push(push);
     }
+    this->taintMemo.insert_or_assign(std::move(key), std::move(entry));
 
     printTaintMap(taintMap);
     std::cout << "functionStack size: " << functionStack.size() << std::endl;
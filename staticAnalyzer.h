@@ -12,7 +12,7 @@
 #include <unordered_map>
 #include <algorithm>
 #include <unordered_set>
-#include <regex>
+#include <string_view>
 #include <algorithm>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
@@ -30,6 +30,9 @@
 #include <map>
 #include <set>
 #include "node.h"
+#include "srcMLParser.h"
+#include "functionIndex.h"
+#include "taintSet.h"
 using namespace std;
 #ifndef STATICANALYZER_H
 #define STATICANALYZER_H
@@ -54,40 +57,150 @@ typedef enum {
     NAMESPACE_DEFINITION,        // Represents namespace definitions
     ANNOTATION,                  // Represents annotations (common in Java or similar languages)
     CONSTRUCTOR_DEFINITION,      // Represents constructor definitions in OOP languages
-    DESTRUCTOR_DEFINITION        // Represents destructor definitions in OOP languages
+    DESTRUCTOR_DEFINITION,       // Represents destructor definitions in OOP languages
+    RETURN_STATEMENT,            // Represents return statements
+    PARAMETER_DECLARATION        // Represents function parameters
 } ClassificationType;
 
 
 
+typedef std::vector<std::pair<std::string, bool>> functionInfo;
+typedef std::vector<std::string> variableInfo;
 struct CodeElement {
     std::string type;
     std::string content;
     std::string functionName;
+    // taken from the statement's subtree while the function is parsed
+    variableInfo variables;     // names used by the statement
+    functionInfo calls;         // {callee, hasArguments} of every call in the statement
+    // call statements only
+    std::string callee;
+    std::vector<variableInfo> arguments;    // names used by each argument, indexed by position
+};
+// ids of a function's variable table, a range of FunctionIR::variables
+struct IdRange {
+    const uint32_t* first;
+    const uint32_t* last;
+    const uint32_t* begin() const { return this->first; }
+    const uint32_t* end() const { return this->last; }
+    size_t size() const { return this->last - this->first; }
+};
+// one statement as the taint passes read it, everything is an id or a span into its FunctionIR
+struct Statement {
+    ClassificationType kind;
+    uint32_t callee;                // id of the analyzer's function names, calls only
+    uint32_t variablesBegin;        // variable ids used or set by the statement are [variablesBegin, variablesEnd)
+    uint32_t variablesEnd;
+    uint32_t argumentsBegin;        // per argument spans of a call are [argumentsBegin, argumentsEnd)
+    uint32_t argumentsEnd;
+    uint32_t callsBegin;            // calls made in the statement are [callsBegin, callsEnd)
+    uint32_t callsEnd;
+    uint32_t textBegin;             // source of the statement is [textBegin, textEnd) of the text
+    uint32_t textEnd;
+};
+struct StatementCall {
+    uint32_t callee;                // id of the analyzer's function names
+    bool hasArguments;
+};
+// the statements of one function lowered from its CodeElements, in contiguous arrays
+struct FunctionIR {
+    std::vector<Statement> statements;
+    std::vector<uint32_t> variables;                        // ids of the function's symbol table
+    std::vector<std::pair<uint32_t, uint32_t>> arguments;   // [begin, end) of variables per argument
+    std::vector<StatementCall> calls;
+    std::vector<bool> constants;                            // per variable id, whether the name is a number
+    std::string text;
+    IdRange variablesOf(const Statement& stmt) const;
+    IdRange argument(const Statement& stmt, size_t index) const;
+    size_t argumentCount(const Statement& stmt) const;
+    std::string_view textOf(const Statement& stmt) const;
+};
+// function name -> tainted variables and parameter slots, names are kept in the analyzer's symbol tables
+typedef std::map<std::string, FunctionTaint> TaintMap;
+// bump whenever the layout of the saved taint state or the meaning of its entries changes
+#define TAINT_STATE_VERSION 2
+
+// everything a taint analysis of one function depends on besides its statements
+struct TaintMemoKey {
+    std::string function;
+    std::string previousFunction;
+    bool isForward;
+    bool forceTrack;
+    FunctionTaint input;            // taint of the function when the analysis starts
+    TaintSet previousParams;        // tainted parameters of the previous function
+    bool operator==(const TaintMemoKey& other) const;
+};
+struct TaintMemoKeyHash {
+    size_t operator()(const TaintMemoKey& key) const;
+};
+// what the analysis did: the taint it left, the parameters it tainted in callees and the callees it pushed
+struct TaintMemoEntry {
+    FunctionTaint output;
+    std::vector<std::pair<std::string, uint32_t>> calleeParams;
+    std::vector<std::pair<std::string, bool>> pushes;
+    // what the analysis read besides its key, an entry of an earlier run is replayed only while these still hold
+    uint64_t elementsHash;                                           // statements of the function
+    std::vector<std::pair<std::string, uint64_t>> definitionsUsed;   // callee -> hash of its definitions, 0 when it has none
+    std::vector<std::pair<std::string, bool>> graphNamesUsed;        // callee -> whether it is a node of the graph
+    bool fromState;                                                  // loaded from a state file, not checked in this run yet
 };
-typedef std::map<std::string, std::pair<std::set<std::string>, std::set<std::string>> > TaintMap;
-typedef std::vector<std::pair<std::string, bool>> functionInfo;
-typedef std::vector<std::string> variableInfo;
 class StaticAnalyzer {
 
 private:
-        std::pair<variableInfo, functionInfo> extractVariables(const std::string& expression, const std::string& type);
-        std::vector<std::string> extractVariablesFromXML(const std::string& xml);
-        std::vector<std::pair<std::string, bool>> extractFunctionFromXML(const std::string& xml);
+        SrcMLParser srcml;
+        // function index of every binary asked about, built on first use
+        std::map<std::string, std::unique_ptr<FunctionIndex>> functionIndexes;
+        // variable ids of every function analyzed, shared by all taint maps of the analyzer
+        std::unordered_map<std::string, SymbolTable> symbolTables;
+        // callee ids of the statements, shared by every function
+        SymbolTable functionNames;
+        // every function lowered for the taint passes, by name
+        std::unordered_map<std::string, FunctionIR> functionIRs;
+        const FunctionIR& functionIR(const std::string& function, const std::vector<CodeElement>& stmts);
+        // analyses already run, repeated contexts are replayed from here instead of walking the statements
+        std::unordered_map<TaintMemoKey, TaintMemoEntry, TaintMemoKeyHash> taintMemo;
+        int taintMemoHits;
+        int taintMemoMisses;
+        // parameters tainted in callees by the running analysis, recorded for the memo
+        std::vector<std::pair<std::string, uint32_t>> calleeParams;
+        // definitions and graph nodes read by the running analysis, recorded for the memo
+        std::vector<std::pair<std::string, uint64_t>> definitionsUsed;
+        std::vector<std::pair<std::string, bool>> graphNamesUsed;
+        // hash of the statements of every function analyzed in this run
+        std::unordered_map<std::string, uint64_t> elementHashes;
+        int taintStateReused;
+        void taintCalleeParam(TaintMap& taintMap, const std::string& callee, uint32_t slot);
+        uint64_t elementsHash(const std::string& function, const std::vector<CodeElement>& stmts);
+        bool isMemoCurrent(TaintMemoEntry& entry, const std::string& function, const std::vector<CodeElement>& stmts,
+                           const std::map<std::string, std::vector<std::string>>& definitions,
+                           const std::vector<Node*>& nodesInGraph);
+        std::tuple<std::string, int, int> getFunctionInfoFromBinutils(const std::string& binary, const std::string& function_name);
         std::vector<std::string> extractFromDeclsAndExprs(const std::string& expression);
-        std::vector<std::string> extractFromCall(const std::string& expression);
-        xmlNode* findChildByName(xmlNode* node, const char* name);
-        bool isIgnoredElement(xmlNode* node);
-        bool isValidExpression(char* content, const xmlChar* nodeName);
         bool isdigit(const std::string& str);
 
 public:
+        StaticAnalyzer();
         void printTaintMap(const TaintMap& taintMap);
+        int getTaintMemoHits();
+        int getTaintMemoMisses();
+        int getTaintStateReused();
+        // the memo and the symbol tables it refers to, kept between runs
+        bool saveTaintState(const std::string& path);
+        bool loadTaintState(const std::string& path);
+        SymbolTable& symbolTable(const std::string& function);
+        std::set<std::string> variableNames(const std::string& function, const TaintSet& variables);
+        void addTaint(TaintMap& taintMap, const std::string& function, const std::set<std::string>& variables,
+                      const std::set<std::string>& params);
         ClassificationType classifyElement(xmlNode *node);
-        std::vector<CodeElement> parseElements(xmlNode *node, const std::string& currentFunction = "");
         void printElements(const std::vector<CodeElement>& elements);
         std::string exec(const char* cmd);
+        xmlDocPtr parseSource(const std::string& code);
+        // elements of the source lines of one function, preprocessed and parsed with srcML
+        std::vector<CodeElement> extractElements(std::string_view body);
         std::tuple<std::string, int, int> getFunctionInfo(const std::string& binary, const std::string& function_name);
-        std::string preprocessCode(const std::string& code);
+        // drops what was derived from the function's statements, after its source changed
+        void forgetFunction(const std::string& function);
+        std::string preprocessCode(std::string_view code);
         void TaintAnalysis(const std::vector<CodeElement>& elements,
                            TaintMap& taintMap,
                             std::stack<std::pair<std::string, bool>>& functionStack,
@@ -97,7 +210,7 @@ public:
                            std::string previousFunction,
                            bool isForward,
                            bool forceTrack = false);
-        void backwardTaintAnalysis(const std::vector<CodeElement>& stmts,
+        void backwardTaintAnalysis(const FunctionIR& ir,
                                    TaintMap& taintMap,
                                    std::stack<std::pair<std::string, bool>>& functionStack,
                                     std::map<std::string, std::vector<std::string>> definitions,
@@ -105,11 +218,11 @@ public:
                                    std::string currentFunction,
                                    std::string previousFunction,
                                    bool isForward,
-                                    std::set<std::string>& taintedVariables,
-                                    std::set<std::string>& taintedVariablesPrev,
+                                   TaintSet& taintedVariables,
+                                   const TaintSet& taintedVariablesPrev,
                                    bool forceTrack = false,
                                    bool startToTrack = false);
-        void forwardTaintAnalysis(const std::vector<CodeElement>& stmts,
+        void forwardTaintAnalysis(const FunctionIR& ir,
                                   TaintMap& taintMap,
                                   std::stack<std::pair<std::string, bool>>& functionStack,
                                     std::map<std::string, std::vector<std::string>> definitions,
@@ -117,8 +230,8 @@ public:
                                   std::string currentFunction,
                                   std::string previousFunction,
                                   bool isForward,
-                                    std::set<std::string>& taintedVariables,
-                                    std::set<std::string>& taintedVariablesPrev,
+                                  TaintSet& taintedVariables,
+                                  const TaintSet& taintedVariablesPrev,
                                   bool forceTrack = false,
                                   bool startToTrack = false);
 };
@@ -0,0 +1,173 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#include "taintSet.h"
+#include <algorithm>
+
+uint32_t SymbolTable::intern(std::string_view name) {
+    auto it = this->ids.find(name);
+    if (it != this->ids.end()) {
+        return it->second;
+    }
+    uint32_t id = this->names.size();
+    this->names.emplace_back(name);
+    this->ids.emplace(std::string_view(this->names.back()), id);
+    return id;
+}
+
+int64_t SymbolTable::find(std::string_view name) const {
+    auto it = this->ids.find(name);
+    return it == this->ids.end() ? -1 : it->second;
+}
+
+const std::string& SymbolTable::name(uint32_t id) const {
+    return this->names[id];
+}
+
+size_t SymbolTable::size() const {
+    return this->names.size();
+}
+
+int64_t paramSlot(std::string_view name) {
+    if (name == "$*") {
+        return ALL_RETURNS_SLOT;
+    }
+    if (name.size() < 2 || (name[0] != '#' && name[0] != '$') ||
+        name.find_first_not_of("0123456789", 1) != std::string_view::npos || name.size() > 10) {
+        return -1;
+    }
+    uint32_t index = std::stoul(std::string(name.substr(1)));
+    if (index > MAX_PARAM_INDEX) {
+        return -1;
+    }
+    return name[0] == '#' ? argumentSlot(index) : returnSlot(index);
+}
+
+std::string paramSlotName(uint32_t slot) {
+    if (slot == ALL_RETURNS_SLOT) {
+        return "$*";
+    }
+    return (isArgumentSlot(slot) ? "#" : "$") + std::to_string(slotIndex(slot));
+}
+
+bool isArgumentSlot(uint32_t slot) {
+    return slot % 2 == 1;
+}
+
+uint32_t argumentSlot(uint32_t index) {
+    return 2 * index + 1;
+}
+
+uint32_t returnSlot(uint32_t index) {
+    return 2 * index + 2;
+}
+
+uint32_t slotIndex(uint32_t slot) {
+    return (slot - 1) / 2;
+}
+
+std::set<std::string> paramSlotNames(const TaintSet& params) {
+    std::set<std::string> names;
+    for (uint32_t slot : params.ids()) {
+        names.insert(paramSlotName(slot));
+    }
+    return names;
+}
+
+bool TaintSet::contains(uint32_t id) const {
+    size_t word = id / 64;
+    return word < this->words.size() && (this->words[word] >> (id % 64) & 1) != 0;
+}
+
+bool TaintSet::insert(uint32_t id) {
+    size_t word = id / 64;
+    if (word >= this->words.size()) {
+        this->words.resize(word + 1, 0);
+    }
+    uint64_t bit = (uint64_t)1 << (id % 64);
+    if (this->words[word] & bit) {
+        return false;
+    }
+    this->words[word] |= bit;
+    return true;
+}
+
+bool TaintSet::unionWith(const TaintSet& other) {
+    if (other.words.size() > this->words.size()) {
+        this->words.resize(other.words.size(), 0);
+    }
+    uint64_t* __restrict target = this->words.data();
+    const uint64_t* __restrict source = other.words.data();
+    uint64_t grown = 0;
+    for (size_t i = 0; i < other.words.size(); i++) {
+        uint64_t merged = target[i] | source[i];
+        grown |= merged ^ target[i];
+        target[i] = merged;
+    }
+    return grown != 0;
+}
+
+void TaintSet::intersectWith(const TaintSet& other) {
+    size_t shared = std::min(this->words.size(), other.words.size());
+    uint64_t* __restrict target = this->words.data();
+    const uint64_t* __restrict source = other.words.data();
+    for (size_t i = 0; i < shared; i++) {
+        target[i] &= source[i];
+    }
+    std::fill(this->words.begin() + shared, this->words.end(), 0);
+}
+
+bool TaintSet::empty() const {
+    for (uint64_t word : this->words) {
+        if (word != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t TaintSet::count() const {
+    size_t total = 0;
+    for (uint64_t word : this->words) {
+        total += __builtin_popcountll(word);
+    }
+    return total;
+}
+
+std::vector<uint32_t> TaintSet::ids() const {
+    std::vector<uint32_t> result;
+    for (size_t i = 0; i < this->words.size(); i++) {
+        for (uint64_t word = this->words[i]; word != 0; word &= word - 1) {
+            result.push_back(i * 64 + __builtin_ctzll(word));
+        }
+    }
+    return result;
+}
+
+uint64_t TaintSet::hash(uint64_t seed) const {
+    size_t used = this->words.size();
+    while (used > 0 && this->words[used - 1] == 0) {
+        used--;
+    }
+    uint64_t hash = seed ^ used;
+    for (size_t i = 0; i < used; i++) {
+        hash = (hash ^ this->words[i]) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+bool TaintSet::operator==(const TaintSet& other) const {
+    // trailing zero words do not change the set
+    size_t shared = std::min(this->words.size(), other.words.size());
+    if (!std::equal(this->words.begin(), this->words.begin() + shared, other.words.begin())) {
+        return false;
+    }
+    const std::vector<uint64_t>& longer = this->words.size() > shared ? this->words : other.words;
+    return std::all_of(longer.begin() + shared, longer.end(), [](uint64_t word) { return word == 0; });
+}
+
+bool TaintSet::operator!=(const TaintSet& other) const {
+    return !(*this == other);
+}
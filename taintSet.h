@@ -0,0 +1,79 @@
+//
+// Created by mxu49 on 2026/10/18.
+//
+
+#ifndef DYNAMORIO_TAINTSET_H
+#define DYNAMORIO_TAINTSET_H
+
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Dense ids for the variable names of one function, handed out in order of first use.
+class SymbolTable {
+private:
+    // keys view the names, a deque keeps them in place as it grows
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::deque<std::string> names;
+public:
+    uint32_t intern(std::string_view name);
+    // id of a name already seen, -1 otherwise
+    int64_t find(std::string_view name) const;
+    const std::string& name(uint32_t id) const;
+    size_t size() const;
+};
+
+// Parameter slots have fixed ids shared by every function, so the tainted parameters
+// of a callee can be read in the caller without its symbol table:
+//   $* -> 0, #n -> 2n + 1, $n -> 2n + 2
+// n is at most MAX_PARAM_INDEX, slots are bit positions and a larger n would only blow up every set
+#define MAX_PARAM_INDEX 255
+int64_t paramSlot(std::string_view name);
+std::string paramSlotName(uint32_t slot);
+bool isArgumentSlot(uint32_t slot);
+uint32_t argumentSlot(uint32_t index);
+uint32_t slotIndex(uint32_t slot);
+uint32_t returnSlot(uint32_t index);
+#define ALL_RETURNS_SLOT 0
+
+// A set of small ids packed 64 to a word. Union and intersection run word by word
+// over contiguous storage, which the compiler turns into vector instructions.
+class TaintSet {
+private:
+    std::vector<uint64_t> words;
+public:
+    bool contains(uint32_t id) const;
+    // true when the id was not in the set yet
+    bool insert(uint32_t id);
+    // true when the set grew
+    bool unionWith(const TaintSet& other);
+    void intersectWith(const TaintSet& other);
+    bool empty() const;
+    size_t count() const;
+    std::vector<uint32_t> ids() const;
+    // equal sets hash equally, whatever the number of trailing zero words
+    uint64_t hash(uint64_t seed) const;
+    bool operator==(const TaintSet& other) const;
+    bool operator!=(const TaintSet& other) const;
+};
+
+std::set<std::string> paramSlotNames(const TaintSet& params);
+
+// Taint of one function: variables are ids of the function's symbol table, params are slots.
+struct FunctionTaint {
+    TaintSet variables;
+    TaintSet params;
+    bool operator==(const FunctionTaint& other) const {
+        return this->variables == other.variables && this->params == other.params;
+    }
+    bool operator!=(const FunctionTaint& other) const {
+        return !(*this == other);
+    }
+};
+
+
+#endif //DYNAMORIO_TAINTSET_H